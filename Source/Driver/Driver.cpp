@@ -5,6 +5,7 @@ import FileIOUtils;
 import FileBuffer;
 import Basic;
 import AST;
+import Analysis;
 import Lexer;
 import Sema;
 import Parser;
@@ -29,8 +30,38 @@ void printUsage() {
   std::printf("Options:\n");
   std::printf("  --ast-dump\n");
   std::printf("  --run-sema\n");
-  std::printf("  --emit-llvm\n");
-  std::printf("  --cfg-dump\n");
+  std::printf("  -emit-llvm          Write the LLVM IR of the program\n");
+  std::printf("  -emit-bc            Write the LLVM bitcode of the program\n");
+  std::printf("  -S                  Write the assembly of the program\n");
+  std::printf("  -c                  Write the object file of the program\n");
+  std::printf("  -run                Compile and run the program in process\n");
+  std::printf("  -fruntime=<file>    Link with the runtime <file> into an "
+              "executable\n");
+  std::printf("  -O<N>               Optimize at level N, 0 to 3 "
+              "(default: 0)\n");
+  std::printf("  -print-pipeline-passes\n");
+  std::printf("                      Print the optimization pipeline\n");
+  std::printf("  -o <file>           Write the output to <file> (default: "
+              "stdout)\n");
+  std::printf("  --cfg-dump          Check the program and print its CFGs and "
+              "their analyses\n");
+  std::printf("  -Wunused            Warn about unused variables and dead "
+              "stores\n");
+  std::printf("  -print-stats\n");
+  std::printf("  -ftime-report       Print the time spent in each phase and "
+              "pass\n");
+  std::printf("  -fsyntax-only       Stop after parsing\n");
+  std::printf("  -ferror-limit=<N>   Stop after N errors (0: no limit)\n");
+  std::printf("  -fdiagnostics-format=<text|json|sarif>\n");
+  std::printf("  -fsema-threads=<N>  Check function bodies on N threads "
+              "(0: all cores)\n");
+  std::printf("  -fincremental-edit=<file>\n");
+  std::printf("                      Check the input quietly, then compile "
+              "<file>, an edit\n"
+              "                      of it, reusing the unchanged function "
+              "bodies\n");
+  std::printf("  -fcfg-threads=<N>   Build and analyze CFGs on N threads "
+              "(0: all cores)\n");
 }
 
 class FileBuffer : public llvm::MemoryBuffer {
@@ -62,7 +93,23 @@ int main(int Argc, char *Argv[]) {
   bool AstDumpOpt = false;
   bool RunSemaOpt = false;
   bool EmitLLVMOpt = false;
+  bool EmitBCOpt = false;
+  bool EmitAsmOpt = false;
+  bool EmitObjOpt = false;
+  bool RunOpt = false;
+  StringRef RuntimeOpt;
+  unsigned OptLevelOpt = 0;
+  bool PrintPipelineOpt = false;
+  bool TimeReportOpt = false;
   bool CfgDumpOpt = false;
+  bool WarnUnusedOpt = false;
+  unsigned SemaThreadsOpt = 1;
+  unsigned CfgThreadsOpt = 0;
+  bool PrintStatsOpt = false;
+  bool SyntaxOnlyOpt = false;
+  unsigned ErrorLimitOpt = 0;
+  StringRef EditOpt;
+  std::optional<JSONDiagnosticPrinter::OutputFormat> DiagFormatOpt;
 
   auto ArgsRange = std::span(Argv + 1, Argc - 1);
 
@@ -84,8 +131,59 @@ int main(int Argc, char *Argv[]) {
       RunSemaOpt = true;
     } else if (Arg == "-emit-llvm") {
       EmitLLVMOpt = true;
+    } else if (Arg == "-emit-bc") {
+      EmitBCOpt = true;
+    } else if (Arg == "-S") {
+      EmitAsmOpt = true;
+    } else if (Arg == "-c") {
+      EmitObjOpt = true;
+    } else if (Arg == "-run") {
+      RunOpt = true;
+    } else if (Arg.consume_front("-fruntime=")) {
+      RuntimeOpt = Arg;
+    } else if (Arg == "-print-pipeline-passes") {
+      PrintPipelineOpt = true;
+    } else if (Arg.starts_with("-O") && Arg.size() == 3) {
+      if (Arg.drop_front(2).getAsInteger(10, OptLevelOpt) || OptLevelOpt > 3) {
+        std::printf("Invalid optimization level: %s\n", Arg.data());
+        return -1;
+      }
+    } else if (Arg == "-ftime-report") {
+      TimeReportOpt = true;
     } else if (Arg == "-cfg-dump") {
       CfgDumpOpt = true;
+    } else if (Arg == "-Wunused") {
+      WarnUnusedOpt = true;
+    } else if (Arg == "-print-stats") {
+      PrintStatsOpt = true;
+    } else if (Arg == "-fsyntax-only") {
+      SyntaxOnlyOpt = true;
+    } else if (Arg.consume_front("-ferror-limit=")) {
+      if (Arg.getAsInteger(10, ErrorLimitOpt)) {
+        std::printf("Invalid error limit: %s\n", Arg.data());
+        return -1;
+      }
+    } else if (Arg.consume_front("-fdiagnostics-format=")) {
+      if (Arg == "json") {
+        DiagFormatOpt = JSONDiagnosticPrinter::OutputFormat::JSON;
+      } else if (Arg == "sarif") {
+        DiagFormatOpt = JSONDiagnosticPrinter::OutputFormat::SARIF;
+      } else if (Arg != "text") {
+        std::printf("Invalid diagnostics format: %s\n", Arg.data());
+        return -1;
+      }
+    } else if (Arg.consume_front("-fsema-threads=")) {
+      if (Arg.getAsInteger(10, SemaThreadsOpt)) {
+        std::printf("Invalid number of threads: %s\n", Arg.data());
+        return -1;
+      }
+    } else if (Arg.consume_front("-fincremental-edit=")) {
+      EditOpt = Arg;
+    } else if (Arg.consume_front("-fcfg-threads=")) {
+      if (Arg.getAsInteger(10, CfgThreadsOpt)) {
+        std::printf("Invalid number of threads: %s\n", Arg.data());
+        return -1;
+      }
     } else if (Arg == "-o") {
       if (i + 1 < Argc) {
         OutputOpt = Argv[++i];
@@ -109,6 +207,24 @@ int main(int Argc, char *Argv[]) {
     return -1;
   }
   InputOpt = FirstPositional;
+
+  // Timers that never start cost nothing and are not reported.
+  llvm::TimerGroup Timers("chocopy", "Compilation phases");
+  llvm::Timer ParseTimer("parse", "Parsing", Timers);
+  llvm::Timer SemaTimer("sema", "Semantic analysis", Timers);
+  llvm::Timer AnalysisTimer("analysis", "CFG analyses", Timers);
+  llvm::Timer CodeGenTimer("codegen", "LLVM IR generation", Timers);
+  llvm::Timer OptTimer("opt", "Optimization", Timers);
+  llvm::Timer EmitTimer("emit", "Output writing and native code generation",
+                        Timers);
+  llvm::Timer JITTimer("jit", "JIT compilation", Timers);
+  llvm::Timer RunTimer("run", "Execution", Timers);
+  llvm::Timer FirstOutputTimer("first-output", "Startup to first output",
+                               Timers);
+  auto Time = [&](llvm::Timer &T) { return TimeReportOpt ? &T : nullptr; };
+  if (TimeReportOpt && RunOpt)
+    FirstOutputTimer.startTimer();
+
 //   std::printf("Input: %s\n", InputOpt.data());
 
   std::optional<std::string> Content = Utils::ReadFile(InputOpt);
@@ -128,7 +244,17 @@ int main(int Argc, char *Argv[]) {
   SrcMgr.AddNewSourceBuffer(std::move(Buffer), llvm::SMLoc());
 
   TextDiagnosticPrinter DiagPrinter(SrcMgr);
-  DiagnosticsEngine DiagsEngine(&DiagPrinter);
+  std::optional<JSONDiagnosticPrinter> JSONPrinter;
+  DiagnosticConsumer *DiagConsumer = &DiagPrinter;
+  if (DiagFormatOpt)
+    DiagConsumer = &JSONPrinter.emplace(SrcMgr, llvm::errs(), *DiagFormatOpt);
+  DiagnosticsEngine DiagsEngine(DiagConsumer);
+  DiagsEngine.setErrorLimit(ErrorLimitOpt);
+  // With -fincremental-edit the input is a previous version of the program,
+  // whose diagnostics are not reported.
+  StoredDiagnosticConsumer PreviousDiags;
+  if (!EditOpt.empty())
+    DiagsEngine.setClient(&PreviousDiags);
 
   Lexer TheLexer(DiagsEngine, SrcMgr);
   TheLexer.reset();
@@ -138,34 +264,167 @@ int main(int Argc, char *Argv[]) {
 
   ASTContext ASTCtx(SrcMgr);
   Sema Actions(DiagsEngine, ASTCtx);
+  Actions.setNumThreads(SemaThreadsOpt);
+  Actions.setIncremental(!EditOpt.empty());
   Parser TheParser(ASTCtx, TheLexer, Actions);
 
   ASTCtx.initialize(TheLexer.getSymbolTable());
-  Actions.initialize();
 
-  if (Program *P = TheParser.parse()) {
+  Program *P;
+  {
+    llvm::TimeRegion Region(Time(ParseTimer));
+    P = TheParser.parse();
+  }
+
+  // The edit is parsed into the same context and checked by the same Sema,
+  // which reuses what it learned about the bodies that did not change.
+  // Everything after works on the edit.
+  if (!EditOpt.empty()) {
+    if (P && !SyntaxOnlyOpt) {
+      llvm::TimeRegion Region(Time(SemaTimer));
+      Actions.run();
+    }
+
+    std::optional<std::string> Edit = Utils::ReadFile(EditOpt);
+    if (!Edit) {
+      std::printf("Failed to read file\n");
+      return -1;
+    }
+    auto EditName = std::filesystem::path(EditOpt.str()).filename().string();
+    unsigned EditID = SrcMgr.AddNewSourceBuffer(
+        std::make_unique<FileBuffer>(*Edit, EditName), llvm::SMLoc());
+    DiagsEngine.setClient(DiagConsumer);
+    DiagsEngine.reset();
+    TheLexer.enterBuffer(EditID);
+
+    llvm::TimeRegion Region(Time(ParseTimer));
+    P = Parser(ASTCtx, TheLexer, Actions).parse();
+  }
+
+  if (P) {
     if (AstDumpOpt) {
       P->dump(ASTCtx);
       std::printf("\n");
     }
 
-    if (RunSemaOpt || EmitLLVMOpt)
+    // With -fsyntax-only, or once the error limit is reached, neither Sema nor
+    // CodeGen run.
+    bool RunActions =
+        !SyntaxOnlyOpt && !DiagsEngine.hasErrorLimitBeenReached();
+    bool EmitNative = EmitAsmOpt || EmitObjOpt || !RuntimeOpt.empty();
+    bool EmitCode = EmitLLVMOpt || EmitBCOpt || EmitNative || RunOpt;
+    // The analyses need the declarations and types Sema resolves.
+    if (RunActions && (RunSemaOpt || CfgDumpOpt || EmitCode)) {
+      llvm::TimeRegion Region(Time(SemaTimer));
       Actions.run();
+      if (PrintStatsOpt)
+        Actions.printStats(llvm::errs());
+    }
+
+    // Warnings need the declarations Sema resolved, and are noise next to
+    // errors.
+    bool WarnUnused =
+        WarnUnusedOpt && RunSemaOpt && !DiagsEngine.getNumErrors();
+    if (RunActions && (CfgDumpOpt || WarnUnused)) {
+      llvm::TimeRegion Region(Time(AnalysisTimer));
+      ProgramAnalysis PA(ASTCtx, P);
+      PA.setNumThreads(CfgThreadsOpt);
+      PA.run();
+      if (WarnUnused)
+        PA.emitWarnings(DiagsEngine);
+      if (CfgDumpOpt)
+        PA.print(llvm::errs());
+    }
+
+    // The JIT takes the context along with the module.
+    std::unique_ptr<llvm::LLVMContext> LLVMCtx;
+    std::unique_ptr<llvm::Module> M;
+    if (RunActions && EmitCode && !DiagsEngine.getNumErrors()) {
+      llvm::TimeRegion Region(Time(CodeGenTimer));
+      LLVMCtx = std::make_unique<llvm::LLVMContext>();
+      M = createLLVMCodegen(*LLVMCtx, ASTCtx, DiagsEngine)
+              ->handleProgram(P, FileName);
+    }
 
-    // llvm::LLVMContext LLVMCtx;
+    // What CodeGen cannot compile yet is reported instead of emitted.
+    if (M) {
+      std::string Error;
+      // At -O0 the module is emitted as generated.
+      if (OptLevelOpt || PrintPipelineOpt) {
+        llvm::TimeRegion Region(Time(OptTimer));
+        OptimizationOptions Opts;
+        Opts.Level = OptLevelOpt;
+        Opts.TimePasses = TimeReportOpt;
+        Opts.PrintPipeline = PrintPipelineOpt;
+        if (!optimizeModule(*M, Opts, Error)) {
+          std::fprintf(stderr, "Cannot optimize for the host: %s\n",
+                       Error.c_str());
+          return -1;
+        }
+      }
 
-    // std::unique_ptr<CodeGenerator> CodeGen = createLLVMCodegen(LLVMCtx,
-    // ASTCtx); std::unique_ptr<llvm::Module>  M       =
-    // CodeGen->handleProgram(P, file_path);
-    // // std::error_code EC;
-    // // llvm::raw_fd_ostream OS("a.out", EC, llvm::sys::fs::OF_Text);
-    // // OS << *M;
-    // M->print(llvm::outs(), nullptr);
+      if (RunOpt) {
+        JITOptions Opts;
+        Opts.CompileTimer = Time(JITTimer);
+        Opts.RunTimer = Time(RunTimer);
+        Opts.FirstOutputTimer = Time(FirstOutputTimer);
+        if (!runModule(std::move(M), std::move(LLVMCtx), Opts, Error)) {
+          std::fprintf(stderr, "Cannot run the program: %s\n", Error.c_str());
+          return -1;
+        }
+      } else {
+        llvm::TimeRegion Region(Time(EmitTimer));
+        bool EmitExecutable =
+            !EmitLLVMOpt && !EmitBCOpt && !EmitAsmOpt && !EmitObjOpt;
+        if (EmitExecutable) {
+          StringRef Output = OutputOpt == "-" ? StringRef("a.out") : OutputOpt;
+          if (!emitExecutable(*M, RuntimeOpt, Output, Error)) {
+            std::fprintf(stderr, "Cannot link %s: %s\n", Output.data(),
+                         Error.c_str());
+            return -1;
+          }
+        } else {
+          // The stream buffers the whole output and writes it in large chunks.
+          std::error_code EC;
+          llvm::raw_fd_ostream OS(OutputOpt, EC,
+                                  EmitLLVMOpt || EmitAsmOpt
+                                      ? llvm::sys::fs::OF_Text
+                                      : llvm::sys::fs::OF_None);
+          if (EC) {
+            std::fprintf(stderr, "Cannot open %s: %s\n", OutputOpt.data(),
+                         EC.message().c_str());
+            return -1;
+          }
+          if (EmitLLVMOpt) {
+            M->print(OS, nullptr);
+          } else if (EmitBCOpt) {
+            llvm::WriteBitcodeToFile(*M, OS);
+          } else if (!emitNativeCode(*M,
+                                     EmitAsmOpt ? BackendOutput::Assembly
+                                                : BackendOutput::Object,
+                                     OS, Error)) {
+            std::fprintf(stderr, "Cannot compile for the host: %s\n",
+                         Error.c_str());
+            return -1;
+          }
+        }
+      }
+    }
   }
+
+  if (TimeReportOpt)
+    Timers.print(llvm::errs(), /*ResetAfterPrint=*/true);
+
 //   if (int ErrCnt = DiagsEngine.getNumErrors())
 //     llvm::outs() << ErrCnt << " error" << (ErrCnt == 1 ? "" : "s")
 //                  << " generated!" << "\n";
 
+  // Machine-readable output is a single document, without the summary.
+  if (JSONPrinter) {
+    JSONPrinter->finish();
+    return 0;
+  }
+
   auto ErrNum = DiagsEngine.getNumErrors();
   if (ErrNum > 0) {
     std::fprintf(stderr, "%u error%s generated!\n", ErrNum,
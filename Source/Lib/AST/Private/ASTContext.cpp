@@ -4,6 +4,7 @@ module;
 
 module AST;
 import :ASTContext;
+import :ClassMemberTable;
 import :AST;
 import Basic;
 import std;
@@ -34,7 +35,9 @@ Identifier *ASTContext::createIdentifier(SMRange Loc, SymbolInfo *Name) {
 
 Program *ASTContext::createProgram(const DeclList &Decls,
                                    const StmtList &Stmts) {
-  assert(!TheProgram);
+  // A context may be reused for a re-parsed version of the source. Nodes of
+  // the previous program stay alive, so that incremental Sema can reuse what
+  // it learned about them.
   TheProgram = create<Program>(Decls, Stmts);
   return TheProgram;
 }
@@ -174,23 +177,43 @@ UnaryExpr *ASTContext::createUnaryExpr(SMRange Loc, UnaryExpr::OpKind Kind,
 }
 
 ClassValueType *ASTContext::getClassVType(StringRef Name) {
-  if (ClassValueType *C = ClassVTypes.lookup(Name))
-    return C;
+  {
+    std::shared_lock Lock(TypesMutex);
+    if (ClassValueType *C = ClassVTypes.lookup(Name))
+      return C;
+  }
 
-  return ClassVTypes.insert({Name, create<ClassValueType>(*this, Name)})
-      .first->getValue();
+  std::unique_lock Lock(TypesMutex);
+  auto [It, Inserted] = ClassVTypes.try_emplace(Name, nullptr);
+  if (Inserted)
+    It->second = create<ClassValueType>(*this, It->getKey());
+  return It->second;
 }
 
 ListValueType *ASTContext::getListVType(ValueType *ElTy) {
-  if (ListValueType *L = ListVTypes.lookup(ElTy))
-    return L;
-  return ListVTypes.insert({ElTy, create<ListValueType>(*this, ElTy)})
-      .first->getSecond();
+  {
+    std::shared_lock Lock(TypesMutex);
+    if (ListValueType *L = ListVTypes.lookup(ElTy))
+      return L;
+  }
+
+  std::unique_lock Lock(TypesMutex);
+  auto [It, Inserted] = ListVTypes.try_emplace(ElTy, nullptr);
+  if (Inserted)
+    It->second = create<ListValueType>(*this, ElTy);
+  return It->second;
 }
 
 FuncType *ASTContext::getFuncType(const ValueTypeList &ParametersTy,
                                   ValueType *RetTy) {
   const FuncTypeKeyInfo::KeyTy Key{RetTy, ParametersTy};
+  {
+    std::shared_lock Lock(TypesMutex);
+    if (auto It = FuncTypes.find_as(Key); It != FuncTypes.end())
+      return *It;
+  }
+
+  std::unique_lock Lock(TypesMutex);
   auto It = FuncTypes.insert_as(nullptr, Key);
   if (It.second)
     *It.first = create<FuncType>(ParametersTy, RetTy);
@@ -198,6 +221,13 @@ FuncType *ASTContext::getFuncType(const ValueTypeList &ParametersTy,
   return *It.first;
 }
 
+const ClassMemberTable &
+ASTContext::createMemberTable(ClassDef *C, const ClassMemberTable *Super) {
+  std::unique_ptr<ClassMemberTable> &T = MemberTables[C];
+  T = std::make_unique<ClassMemberTable>(C, Super);
+  return *T;
+}
+
 ValueType *ASTContext::convertAnnotationToVType(TypeAnnotation *TA) {
   return llvm::TypeSwitch<TypeAnnotation *, ValueType *>(TA)
       .Case([this](ClassType *CT) { return getClassVType(CT->getClassName()); })
@@ -237,6 +267,7 @@ void ASTContext::initPredefinedClasses(SymbolTable &ST) {
   Identifier *NoneId = createIdentifier(Loc, &ST.get(NONE));
   Identifier *EmptyId = createIdentifier(Loc, &ST.get(EMPTY));
   Identifier *InitId = createIdentifier(Loc, &ST.get(INIT));
+  InitSI = InitId->getSymbolInfo();
   Identifier *ThisId = createIdentifier(Loc, &ST.get(THIS));
 
   ClassType *ObjTy = createClassType(Loc, OBJECT);
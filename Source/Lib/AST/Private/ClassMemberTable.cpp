@@ -0,0 +1,54 @@
+module AST;
+import :AST;
+import :ClassMemberTable;
+import Basic;
+
+namespace chocopy {
+ClassMemberTable::ClassMemberTable(ClassDef *C, const ClassMemberTable *Super)
+    : Class(C) {
+  if (Super) {
+    Attributes = Super->Attributes;
+    Methods = Super->Methods;
+    Index = Super->Index;
+  }
+
+  for (Declaration *D : C->getDeclarations())
+    if (isa<VarDef, FuncDef>(D))
+      addMember(D);
+}
+
+auto ClassMemberTable::lookup(const SymbolInfo *SI) const -> const Member * {
+  auto It = Index.find(SI);
+  if (It == Index.end())
+    return nullptr;
+  const Entry &E = It->second;
+  return E.IsMethod ? &Methods[E.Slot] : &Attributes[E.Slot];
+}
+
+void ClassMemberTable::addMember(Declaration *D) {
+  bool IsMethod = isa<FuncDef>(D);
+  SmallVectorImpl<Member> &Members = IsMethod ? Methods : Attributes;
+  auto [It, Inserted] =
+      Index.try_emplace(D->getSymbolInfo(), Entry{IsMethod, 0});
+
+  if (!Inserted) {
+    Entry &E = It->second;
+    // A duplicate in the class itself was diagnosed by Sema, the first one
+    // wins.
+    const Member &Prev = E.IsMethod ? Methods[E.Slot] : Attributes[E.Slot];
+    if (Prev.Owner == Class)
+      return;
+
+    // An override takes the slot of the inherited member. Redefining an
+    // inherited attribute as a method or the reverse is an error Sema
+    // reports, the inherited member stays so that both lists keep their
+    // slots.
+    if (E.IsMethod == IsMethod)
+      Members[E.Slot] = Member{D, Class, E.Slot};
+    return;
+  }
+
+  It->second.Slot = Members.size();
+  Members.push_back(Member{D, Class, It->second.Slot});
+}
+} // namespace chocopy
@@ -646,7 +646,7 @@ private:
   SymbolInfo *Name;
 
   // @todo: Redesign declaration info
-  Declaration *DeclInfo;
+  Declaration *DeclInfo = nullptr;
 };
 
 /** Conditional expressions. */
@@ -1,6 +1,8 @@
 export module AST:ASTContext;
 import Basic;
+import std;
 import :AST;
+import :ClassMemberTable;
 import :Type;
 export namespace chocopy {
 
@@ -84,13 +86,25 @@ public:
   UnaryExpr *createUnaryExpr(SMRange Loc, UnaryExpr::OpKind Kind,
                              Expr *Operand);
 
-  // Value types
+  // Value types. These are safe to call concurrently, e.g. from
+  // Sema workers checking function bodies in parallel.
   ClassValueType *getClassVType(StringRef Name);
   ListValueType *getListVType(ValueType *ElTy);
   FuncType *getFuncType(const ValueTypeList &ParametersTy, ValueType *RetTy);
 
   ValueType *convertAnnotationToVType(TypeAnnotation *TA);
 
+  // Class member tables. These are built by Sema once the classes have been
+  // checked, and are reused by CodeGen for the object and dispatch tables.
+  const ClassMemberTable &createMemberTable(ClassDef *C,
+                                            const ClassMemberTable *Super);
+  const ClassMemberTable *getMemberTable(const ClassDef *C) const {
+    auto It = MemberTables.find(C);
+    return It != MemberTables.end() ? It->second.get() : nullptr;
+  }
+
+  SymbolInfo *getInitSymbol() const { return InitSI; }
+
   bool isAssignementCompatibility(const ValueType *Sub, const ValueType *Sup);
 
 private:
@@ -176,6 +190,8 @@ private:
   FuncDef *InputFD = nullptr;
   FuncDef *LenFD = nullptr;
 
+  SymbolInfo *InitSI = nullptr;
+
   ClassValueType *ObjectTy = nullptr;
   ClassValueType *IntTy = nullptr;
   ClassValueType *StrTy = nullptr;
@@ -183,9 +199,14 @@ private:
   ClassValueType *NoneTy = nullptr;
   ClassValueType *EmptyTy = nullptr;
 
+  // Guards the type uniquing maps below and the allocations they make.
+  mutable std::shared_mutex TypesMutex;
   // Map from Element type to List type
   llvm::DenseMap<ValueType *, ListValueType *> ListVTypes;
   llvm::StringMap<ClassValueType *> ClassVTypes;
   llvm::DenseSet<FuncType *, FuncTypeKeyInfo> FuncTypes;
+
+  llvm::DenseMap<const ClassDef *, std::unique_ptr<ClassMemberTable>>
+      MemberTables;
 };
 } // namespace chocopy
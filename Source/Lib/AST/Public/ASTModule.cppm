@@ -3,6 +3,7 @@ export module AST;
 export import :AST;
 export import :ASTContext;
 export import :ASTNodeTraverser;
+export import :ClassMemberTable;
 export import :DeclVisitor;
 export import :ExprVisitor;
 export import :JSONASTDumper;
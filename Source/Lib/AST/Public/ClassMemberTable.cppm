@@ -0,0 +1,50 @@
+export module AST:ClassMemberTable;
+import :AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// Flattened view of the attributes and methods of a class, including the
+/// inherited ones. Attributes and methods are numbered separately and an
+/// inherited member keeps the slot it has in the superclass, so the slots
+/// give the object layout and the dispatch table layout directly.
+class ClassMemberTable {
+public:
+  struct Member {
+    /// The VarDef or FuncDef that is visible in the class.
+    Declaration *Decl;
+    /// The class declaring the member.
+    ClassDef *Owner;
+    unsigned Slot;
+
+    bool isMethod() const { return isa<FuncDef>(Decl); }
+  };
+
+public:
+  /// Builds the table of \p C on top of the table of its superclass.
+  ClassMemberTable(ClassDef *C, const ClassMemberTable *Super);
+
+  ClassDef *getClass() const { return Class; }
+
+  /// Returns the member named \p SI, or null if there is none.
+  const Member *lookup(const SymbolInfo *SI) const;
+
+  ArrayRef<Member> attributes() const { return Attributes; }
+  ArrayRef<Member> methods() const { return Methods; }
+
+private:
+  void addMember(Declaration *D);
+
+private:
+  struct Entry {
+    bool IsMethod;
+    unsigned Slot;
+  };
+
+  ClassDef *Class;
+  SmallVector<Member, 8> Attributes;
+  SmallVector<Member, 8> Methods;
+  llvm::DenseMap<const SymbolInfo *, Entry> Index;
+};
+} // namespace chocopy
@@ -19,7 +19,7 @@ class CFGBuilder : public StmtVisitor<CFGBuilder, CFGBlock *>,
   using ExprVisitorBase = ExprVisitor<CFGBuilder, CFGBlock *>;
 
 public:
-  std::unique_ptr<CFG> buildCFG(FuncDef *F);
+  std::unique_ptr<CFG> buildCFG(ArrayRef<Stmt *> Stmts, FuncDef *F);
 
   void autoCreateBlock() {
     if (!Block)
@@ -34,6 +34,11 @@ public:
   }
 
   CFGBlock *visit(Stmt *S) { return StmtVisitorBase::visit(S); }
+  /// Visits \p Stmts backwards. Afterwards the block they start in is Block,
+  /// or Succ if Block is null.
+  void visitStmts(ArrayRef<Stmt *> Stmts);
+  /// The block control enters next, going backwards.
+  CFGBlock *getCurrentBlock() const { return Block ? Block : Succ; }
 
   CFGBlock *visitAssignStmt(AssignStmt *S);
   CFGBlock *visitExprStmt(ExprStmt *S);
@@ -65,38 +70,196 @@ private:
   CFGBlock *Block = nullptr;
   CFGBlock *Succ = nullptr;
 };
+
+/// Collects the names that nested functions and classes refer to or declare
+/// global or nonlocal.
+class CapturedNameCollector
+    : public RecursiveASTVisitor<CapturedNameCollector> {
+public:
+  explicit CapturedNameCollector(llvm::DenseSet<const SymbolInfo *> &Names)
+      : Names(Names) {}
+
+  bool visitDeclRef(DeclRef *D) {
+    Names.insert(D->getSymbolInfo());
+    return true;
+  }
+
+  bool visitGlobalDecl(GlobalDecl *D) {
+    Names.insert(D->getSymbolInfo());
+    return true;
+  }
+
+  bool visitNonLocalDecl(NonLocalDecl *D) {
+    Names.insert(D->getSymbolInfo());
+    return true;
+  }
+
+private:
+  llvm::DenseSet<const SymbolInfo *> &Names;
+};
 } // namespace
 
-std::unique_ptr<CFG> CFG::buildCFG(FuncDef *F) {
+std::unique_ptr<CFG> CFG::buildCFG(ArrayRef<Stmt *> Stmts, FuncDef *F) {
   CFGBuilder Builder;
-  return Builder.buildCFG(F);
+  std::unique_ptr<CFG> Cfg = Builder.buildCFG(Stmts, F);
+  Cfg->setBody(Stmts);
+  return Cfg;
 }
 
+std::unique_ptr<CFG> CFG::buildCFG(FuncDef *F) {
+  std::unique_ptr<CFG> Cfg = buildCFG(F->getStatements(), F);
+  Cfg->setDeclarations(F->getDeclarations());
+  return Cfg;
+}
+
+std::unique_ptr<CFG> CFG::buildCFG(Program *P) {
+  std::unique_ptr<CFG> Cfg = buildCFG(P->getStatements(), nullptr);
+  Cfg->setDeclarations(P->getDeclarations());
+  return Cfg;
+}
+
+llvm::DenseSet<const SymbolInfo *> CFG::collectLocalNames() const {
+  llvm::DenseSet<const SymbolInfo *> Locals;
+  llvm::DenseSet<const SymbolInfo *> Captured;
+  CapturedNameCollector Collector(Captured);
+  for (Declaration *D : Declarations) {
+    if (auto *V = dyn_cast<VarDef>(D))
+      Locals.insert(V->getSymbolInfo());
+    else if (isa<FuncDef, ClassDef>(D))
+      Collector.traverseDeclaration(D);
+  }
+  if (Function)
+    for (ParamDecl *P : Function->getParams())
+      Locals.insert(P->getSymbolInfo());
+  for (const SymbolInfo *SI : Captured)
+    Locals.erase(SI);
+  return Locals;
+}
+
+struct CFG::BuildState {
+  SmallVector<CFGBlock *, 0> Blocks;
+  SmallVector<CFGElement, 0> Elements;
+  SmallVector<std::pair<CFGBlock *, CFGBlock *>, 0> Edges;
+};
+
+CFG::CFG() : Pending(std::make_unique<BuildState>()) {}
+
+CFG::~CFG() = default;
+
 CFGBlock *CFG::createBlock() {
-  bool isFirst = begin() == end();
-  CFGBlock *B = new (Allocator) CFGBlock(NumBlockIds++);
-  Blocks.push_back(B);
+  assert(Pending && "CFG is already finalized");
+  bool isFirst = NumBlockIds == 0;
+  CFGBlock *B = new (Allocator) CFGBlock(this, NumBlockIds++);
+  Pending->Blocks.push_back(B);
 
   if (isFirst)
-    Entry = Exit = &back();
+    Entry = Exit = B;
 
-  return &back();
+  return B;
 }
 
-std::unique_ptr<CFG> CFGBuilder::buildCFG(FuncDef *F) {
-  Succ = createBlock();
-  CFGBlock *B = Succ;
-  for (Stmt *S : llvm::reverse(F->getStatements())) {
-    B = Succ = visit(S);
-    if (isa<WhileStmt>(S))
-      Block = nullptr;
+void CFGBlock::addSuccessor(CFGBlock *B) {
+  assert(Parent->Pending && "CFG is already finalized");
+  Parent->Pending->Edges.emplace_back(this, B);
+}
+
+void CFGBlock::appendStmt(Stmt *S) {
+  assert(Parent->Pending && "CFG is already finalized");
+  Parent->Pending->Elements.push_back(CFGElement(this, S));
+}
+
+void CFGBlock::appendExpr(Expr *E) {
+  assert(Parent->Pending && "CFG is already finalized");
+  Parent->Pending->Elements.push_back(CFGElement(this, E));
+}
+
+/// Copies \p Items to one array in \p Allocator, grouped by the block
+/// \p GetBlock returns for each and keeping their order within a group.
+/// Sets \p Starts to the index of the first item of each block, followed by
+/// the number of items.
+template <typename ValueT, typename ItemT, typename BlockFn, typename ValueFn>
+static ValueT *layOutByBlock(llvm::BumpPtrAllocator &Allocator,
+                             ArrayRef<ItemT> Items, unsigned NumBlocks,
+                             BlockFn GetBlock, ValueFn GetValue,
+                             SmallVectorImpl<unsigned> &Starts) {
+  Starts.assign(NumBlocks + 1, 0);
+  for (const ItemT &I : Items)
+    ++Starts[GetBlock(I)->getBlockId() + 1];
+  for (unsigned B = 0; B != NumBlocks; ++B)
+    Starts[B + 1] += Starts[B];
+
+  ValueT *Array = Allocator.Allocate<ValueT>(Items.size());
+  SmallVector<unsigned, 0> Next(Starts.begin(), Starts.end() - 1);
+  for (const ItemT &I : Items)
+    new (&Array[Next[GetBlock(I)->getBlockId()]++]) ValueT(GetValue(I));
+  return Array;
+}
+
+void CFG::finalize() {
+  assert(Pending && "CFG is already finalized");
+  using Edge = std::pair<CFGBlock *, CFGBlock *>;
+
+  NumBlocks = Pending->Blocks.size();
+  Blocks = Allocator.Allocate<CFGBlock *>(NumBlocks);
+  std::copy(Pending->Blocks.begin(), Pending->Blocks.end(), Blocks);
+
+  SmallVector<unsigned, 0> Starts;
+  CFGElement *Elements = layOutByBlock<CFGElement>(
+      Allocator, ArrayRef<CFGElement>(Pending->Elements), NumBlocks,
+      [](const CFGElement &El) { return El.getParent(); },
+      [](const CFGElement &El) { return El; }, Starts);
+  for (CFGBlock *B : *this) {
+    B->Elements = Elements + Starts[B->BlockId];
+    B->NumElements = Starts[B->BlockId + 1] - Starts[B->BlockId];
   }
 
-  Succ = B;
+  // Edges were added in the order of the successors of each block, which
+  // matters for terminators.
+  CFGBlock **Succs = layOutByBlock<CFGBlock *>(
+      Allocator, ArrayRef<Edge>(Pending->Edges), NumBlocks,
+      [](const Edge &E) { return E.first; },
+      [](const Edge &E) { return E.second; }, Starts);
+  for (CFGBlock *B : *this) {
+    B->Succs = Succs + Starts[B->BlockId];
+    B->NumSuccs = Starts[B->BlockId + 1] - Starts[B->BlockId];
+  }
+
+  CFGBlock **Preds = layOutByBlock<CFGBlock *>(
+      Allocator, ArrayRef<Edge>(Pending->Edges), NumBlocks,
+      [](const Edge &E) { return E.second; },
+      [](const Edge &E) { return E.first; }, Starts);
+  for (CFGBlock *B : *this) {
+    B->Preds = Preds + Starts[B->BlockId];
+    B->NumPreds = Starts[B->BlockId + 1] - Starts[B->BlockId];
+  }
+
+  Pending.reset();
+}
+
+std::unique_ptr<CFG> CFGBuilder::buildCFG(ArrayRef<Stmt *> Stmts,
+                                          FuncDef *F) {
+  Cfg->setFunction(F);
+  Succ = createBlock();
+  visitStmts(Stmts);
+
+  Succ = getCurrentBlock();
   Cfg->setEntry(createBlock());
+  Cfg->finalize();
   return std::move(Cfg);
 }
 
+void CFGBuilder::visitStmts(ArrayRef<Stmt *> Stmts) {
+  for (Stmt *S : llvm::reverse(Stmts)) {
+    Block = visit(S);
+    // The header of a loop is entered from its back edge too, so what comes
+    // before the loop starts a new block.
+    if (isa<WhileStmt>(S)) {
+      Succ = Block;
+      Block = nullptr;
+    }
+  }
+}
+
 CFGBlock *CFGBuilder::visitAssignStmt(AssignStmt *S) {
   autoCreateBlock();
   CFGBlock *B = Block;
@@ -112,13 +275,12 @@ CFGBlock *CFGBuilder::visitExprStmt(ExprStmt *S) {
 }
 
 CFGBlock *CFGBuilder::visitForStmt(ForStmt *F) {
-  CFGBlock *Exit = Block ? Block : &Cfg->getExit();
+  CFGBlock *Exit = getCurrentBlock();
 
   Block = createBlock(false);
   CFGBlock *Latch = Block;
-  for (Stmt *S : llvm::reverse(F->getBody()))
-    visit(S);
-  CFGBlock *Body = Block;
+  visitStmts(F->getBody());
+  CFGBlock *Body = getCurrentBlock();
 
   Block = createBlock(false);
   CFGBlock *Header = Block;
@@ -136,23 +298,20 @@ CFGBlock *CFGBuilder::visitForStmt(ForStmt *F) {
 }
 
 CFGBlock *CFGBuilder::visitIfStmt(IfStmt *I) {
-  Succ = Block ? Block : &Cfg->getExit();
+  Succ = getCurrentBlock();
 
   CFGBlock *ElseBlock = Succ;
   if (!I->getElseBody().empty()) {
     Block = createBlock();
-    for (Stmt *S : llvm::reverse(I->getElseBody()))
-      Block = visit(S);
-    Succ = ElseBlock;
-    ElseBlock = Block;
+    visitStmts(I->getElseBody());
+    CFGBlock *Join = ElseBlock;
+    ElseBlock = getCurrentBlock();
+    Succ = Join;
   }
 
   Block = createBlock();
-  if (!I->getThenBody().empty()) {
-    for (Stmt *S : llvm::reverse(I->getThenBody()))
-      Block = visit(S);
-  }
-  CFGBlock *ThenBlock = Block;
+  visitStmts(I->getThenBody());
+  CFGBlock *ThenBlock = getCurrentBlock();
 
   Block = createBlock(false);
   Block->addSuccessor(ThenBlock);
@@ -171,14 +330,13 @@ CFGBlock *CFGBuilder::visitReturnStmt(ReturnStmt *S) {
 }
 
 CFGBlock *CFGBuilder::visitWhileStmt(WhileStmt *S) {
-  CFGBlock *Exit = Block ? Block : &Cfg->getExit();
+  CFGBlock *Exit = getCurrentBlock();
 
   Block = createBlock(false);
   CFGBlock *Latch = Block;
-  for (Stmt *S : llvm::reverse(S->getBody()))
-    Block = visit(S);
+  visitStmts(S->getBody());
 
-  CFGBlock *Body = Block;
+  CFGBlock *Body = getCurrentBlock();
   CFGBlock *Header = createBlock(false);
   Header->setTerminator(S);
 
@@ -274,9 +432,10 @@ CFGBlock *CFGBuilder::visitBinaryExpr(BinaryExpr *B) {
 CFGBlock *CFGBuilder::visitCallExpr(CallExpr *C) {
   autoCreateBlock();
   Block->appendExpr(C);
-  visit(C->getFunction());
-  for (Expr *E : C->getArgs())
+  // Arguments are evaluated left to right, after the callee.
+  for (Expr *E : llvm::reverse(C->getArgs()))
     visit(E);
+  visit(C->getFunction());
   return Block;
 }
 
@@ -338,9 +497,9 @@ CFGBlock *CFGBuilder::visitMemberExpr(MemberExpr *E) {
 CFGBlock *CFGBuilder::visitMethodCallExpr(MethodCallExpr *M) {
   autoCreateBlock();
   Block->appendExpr(M);
-  visit(M->getMethod());
-  for (Expr *E : M->getArgs())
+  for (Expr *E : llvm::reverse(M->getArgs()))
     visit(E);
+  visit(M->getMethod());
   return Block;
 }
 
@@ -0,0 +1,72 @@
+module;
+
+#include <cassert>
+
+module Analysis;
+import :CFG;
+import :CFGCache;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+namespace {
+class FuncCollector : public RecursiveASTVisitor<FuncCollector> {
+public:
+  explicit FuncCollector(SmallVectorImpl<FuncDef *> &Functions)
+      : Functions(Functions) {}
+
+  bool visitFuncDef(FuncDef *F) {
+    Functions.push_back(F);
+    return true;
+  }
+
+  // Only declarations hold functions.
+  bool traverseStmt(Stmt *) { return true; }
+
+private:
+  SmallVectorImpl<FuncDef *> &Functions;
+};
+} // namespace
+
+CFGCache::CFGCache(Program *P) : P(P) {
+  FuncCollector(Functions).traverseProgram(P);
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I)
+    FunctionIndex[Functions[I]] = I;
+  FunctionCFGs.resize(Functions.size());
+}
+
+CFG &CFGCache::getTopLevelCFG() {
+  if (!TopLevel)
+    TopLevel = CFG::buildCFG(P);
+  return *TopLevel;
+}
+
+unsigned CFGCache::getFunctionIndex(const FuncDef *F) const {
+  auto It = FunctionIndex.find(F);
+  assert(It != FunctionIndex.end() && "function is not in the program");
+  return It->second;
+}
+
+CFG &CFGCache::getCFG(FuncDef *F) {
+  std::unique_ptr<CFG> &C = FunctionCFGs[getFunctionIndex(F)];
+  if (!C)
+    C = CFG::buildCFG(F);
+  return *C;
+}
+
+void CFGCache::buildAll() {
+  for (FuncDef *F : Functions)
+    getCFG(F);
+  getTopLevelCFG();
+}
+
+void CFGCache::dump() {
+  for (FuncDef *F : Functions) {
+    llvm::errs() << "def " << F->getName() << ":\n";
+    getCFG(F).dump();
+  }
+  llvm::errs() << "<top level>:\n";
+  getTopLevelCFG().dump();
+}
+} // namespace chocopy
@@ -1,23 +1,12 @@
 module Analysis;
 import :CFG;
+import :CFGCache;
 import AST;
 import Basic;
 import std;
 
 namespace chocopy {
 namespace {
-class FuncVisitor : public RecursiveASTVisitor<FuncVisitor> {
-  using Base = RecursiveASTVisitor<FuncVisitor>;
-
-public:
-  bool visitFuncDef(FuncDef *F) {
-    std::unique_ptr<CFG> C = CFG::buildCFG(F);
-    llvm::errs() << "def " << F->getName() << ":\n";
-    C->dump();
-    return true;
-  }
-};
-
 class PrintHelper : public ConstStmtVisitor<PrintHelper>,
                     public ConstExprVisitor<PrintHelper> {
   using StmtVisitor = ConstStmtVisitor<PrintHelper>;
@@ -27,7 +16,7 @@ class PrintHelper : public ConstStmtVisitor<PrintHelper>,
 
 public:
   PrintHelper(const CFG *Cfg, raw_ostream &OS) : OS(OS) {
-    for (CFGBlock *B : *Cfg) {
+    for (const CFGBlock *B : *Cfg) {
       unsigned j = 0;
       for (CFGElement El : *B) {
         if (El.isStmt()) {
@@ -218,8 +207,9 @@ private:
 };
 } // namespace
 
-static void printTerminator(raw_ostream &OS, CFGTerminator &T, CFGBlock *B,
-                            CFG *Cfg, PrintHelper &Helper) {
+static void printTerminator(raw_ostream &OS, CFGTerminator &T,
+                            const CFGBlock *B, const CFG *Cfg,
+                            PrintHelper &Helper) {
   Helper.setBBId(-1);
   OS.changeColor(raw_ostream::GREEN);
   OS << "  " << llvm::format("%3c", 'T') << ": ";
@@ -231,8 +221,8 @@ static void printTerminator(raw_ostream &OS, CFGTerminator &T, CFGBlock *B,
   OS.resetColor();
 }
 
-static void printElement(raw_ostream &OS, CFGElement &El, CFGBlock *B, CFG *Cfg,
-                         PrintHelper &Helper) {
+static void printElement(raw_ostream &OS, CFGElement &El, const CFGBlock *B,
+                         const CFG *Cfg, PrintHelper &Helper) {
   switch (El.getKind()) {
   case CFGElement::Kind::Expr: {
     Helper.visit(El.getExpr());
@@ -246,7 +236,7 @@ static void printElement(raw_ostream &OS, CFGElement &El, CFGBlock *B, CFG *Cfg,
   OS << "\n";
 }
 
-static void printBlock(raw_ostream &OS, CFGBlock *B, CFG *Cfg,
+static void printBlock(raw_ostream &OS, const CFGBlock *B, const CFG *Cfg,
                        PrintHelper &Helper) {
   OS.changeColor(raw_ostream::YELLOW, true);
 
@@ -293,22 +283,27 @@ static void printBlock(raw_ostream &OS, CFGBlock *B, CFG *Cfg,
   OS.resetColor();
 }
 
-void CFG::dump() {
-  PrintHelper Helper(this, llvm::errs());
+void CFGBlock::print(raw_ostream &OS) const {
+  PrintHelper Helper(Parent, OS);
+  Helper.setBBId(BlockId);
+  printBlock(OS, this, Parent, Helper);
+}
+
+void CFG::print(raw_ostream &OS) const {
+  PrintHelper Helper(this, OS);
   Helper.setBBId(Entry->getBlockId());
-  printBlock(llvm::errs(), Entry, this, Helper);
-  for (CFGBlock *B : *this) {
+  printBlock(OS, Entry, this, Helper);
+  for (const CFGBlock *B : *this) {
     if (B == &getEntry() || B == &getExit())
       continue;
     Helper.setBBId(B->getBlockId());
-    printBlock(llvm::errs(), B, this, Helper);
+    printBlock(OS, B, this, Helper);
   }
   Helper.setBBId(Exit->getBlockId());
-  printBlock(llvm::errs(), Exit, this, Helper);
+  printBlock(OS, Exit, this, Helper);
 }
 
-void dumpCFG(Program *P) {
-  FuncVisitor V;
-  V.traverseProgram(P);
-}
+void CFG::dump() const { print(llvm::errs()); }
+
+void dumpCFG(Program *P) { CFGCache(P).dump(); }
 } // namespace chocopy
\ No newline at end of file
@@ -0,0 +1,202 @@
+module Analysis;
+import :CallGraph;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+bool CallGraphNode::calls(const CallGraphNode *N) const {
+  return std::ranges::contains(Callees, N);
+}
+
+void CallGraphNode::printName(raw_ostream &OS) const {
+  if (!F) {
+    OS << (Id == 0 ? "<external>" : "<top level>");
+    return;
+  }
+  if (Class)
+    OS << Class->getName() << ".";
+  OS << F->getName();
+}
+
+/// Creates a node for every function of the program and then adds the calls
+/// of each.
+class CallGraph::Builder : public RecursiveASTVisitor<Builder> {
+  using Base = RecursiveASTVisitor<Builder>;
+
+public:
+  explicit Builder(CallGraph &G) : G(G) {}
+
+  void build(Program *P) {
+    Collecting = true;
+    traverseProgram(P);
+    for (ClassDef *Class : ClassList)
+      if (ClassDef *Super = getSuperClass(Class))
+        Subclasses[Super].push_back(Class);
+
+    Collecting = false;
+    Current = G.getTopLevelNode();
+    traverseProgram(P);
+  }
+
+  bool traverseClassDef(ClassDef *C) {
+    if (Collecting) {
+      Classes[C->getName()] = C;
+      ClassList.push_back(C);
+    }
+    SaveAndRestore SaveClass(CurClass, C);
+    return Base::traverseClassDef(C);
+  }
+
+  bool traverseFuncDef(FuncDef *F) {
+    if (Collecting) {
+      CallGraphNode *N = G.createNode(F, CurClass);
+      if (CurClass)
+        MethodsByName[F->getName()].push_back(N);
+    }
+    SaveAndRestore SaveNode(Current, G.getNode(F));
+    SaveAndRestore SaveClass(CurClass, nullptr);
+    return Base::traverseFuncDef(F);
+  }
+
+  bool traverseStmt(Stmt *S) {
+    // The first pass only looks for declarations.
+    if (Collecting)
+      return true;
+    return Base::traverseStmt(S);
+  }
+
+  bool visitCallExpr(CallExpr *C) {
+    auto *Ref = dyn_cast<DeclRef>(C->getFunction());
+    Declaration *D = Ref ? Ref->getDeclInfo() : nullptr;
+    if (auto *F = dyn_cast_if_present<FuncDef>(D))
+      addCall(G.getNode(F));
+    else if (auto *Class = dyn_cast_if_present<ClassDef>(D))
+      addCall(lookupMethod(Class, "__init__"));
+    return true;
+  }
+
+  bool visitMethodCallExpr(MethodCallExpr *M) {
+    StringRef Name = M->getMethod()->getMember()->getName();
+    auto *T = dyn_cast_if_present<ClassValueType>(
+        M->getMethod()->getObject()->getInferredType());
+    ClassDef *Class = T ? Classes.lookup(T->getClassName()) : nullptr;
+    if (!Class) {
+      for (CallGraphNode *N : MethodsByName.lookup(Name))
+        addCall(N);
+      return true;
+    }
+
+    addCall(lookupMethod(Class, Name));
+    SmallVector<ClassDef *, 8> Worklist(Subclasses.lookup(Class));
+    while (!Worklist.empty()) {
+      ClassDef *Sub = Worklist.pop_back_val();
+      addCall(findMethod(Sub, Name));
+      llvm::append_range(Worklist, Subclasses.lookup(Sub));
+    }
+    return true;
+  }
+
+private:
+  void addCall(CallGraphNode *Callee) {
+    if (Callee)
+      G.addCall(Current, Callee);
+  }
+
+  /// The method \p Class declares itself.
+  CallGraphNode *findMethod(ClassDef *Class, StringRef Name) const {
+    for (Declaration *D : Class->getDeclarations())
+      if (auto *F = dyn_cast<FuncDef>(D); F && F->getName() == Name)
+        return G.getNode(F);
+    return nullptr;
+  }
+
+  /// The method \p Class declares or inherits.
+  CallGraphNode *lookupMethod(ClassDef *Class, StringRef Name) const {
+    for (; Class; Class = getSuperClass(Class))
+      if (CallGraphNode *N = findMethod(Class, Name))
+        return N;
+    return nullptr;
+  }
+
+  /// Null for the predefined classes, which have no methods in the graph.
+  ClassDef *getSuperClass(ClassDef *Class) const {
+    Identifier *Super = Class->getSuperClass();
+    return Super ? Classes.lookup(Super->getName()) : nullptr;
+  }
+
+private:
+  CallGraph &G;
+  bool Collecting = false;
+  CallGraphNode *Current = nullptr;
+  ClassDef *CurClass = nullptr;
+  llvm::StringMap<ClassDef *> Classes;
+  SmallVector<ClassDef *, 0> ClassList;
+  llvm::DenseMap<ClassDef *, SmallVector<ClassDef *, 2>> Subclasses;
+  llvm::StringMap<SmallVector<CallGraphNode *, 2>> MethodsByName;
+};
+
+CallGraph::CallGraph(Program *P) {
+  createNode(nullptr, nullptr);
+  createNode(nullptr, nullptr);
+  Builder(*this).build(P);
+
+  for (const std::unique_ptr<CallGraphNode> &N : llvm::drop_begin(Nodes))
+    addCall(getExternalNode(), N.get());
+  computeSCCs();
+}
+
+CallGraphNode *CallGraph::createNode(FuncDef *F, ClassDef *Class) {
+  auto *N = new CallGraphNode(Nodes.size(), F, Class);
+  Nodes.emplace_back(N);
+  if (F)
+    FunctionNodes[F] = N;
+  return N;
+}
+
+void CallGraph::addCall(CallGraphNode *Caller, CallGraphNode *Callee) {
+  if (!Caller->calls(Callee))
+    Caller->Callees.push_back(Callee);
+}
+
+void CallGraph::computeSCCs() {
+  SCCIndex.assign(Nodes.size(), 0);
+  const CallGraph *G = this;
+  for (auto I = llvm::scc_begin(G); !I.isAtEnd(); ++I) {
+    const std::vector<CallGraphNode *> &SCCNodes = *I;
+    // Nothing calls the external node, so it is an SCC of its own.
+    if (SCCNodes.front() == getExternalNode())
+      continue;
+    for (CallGraphNode *N : SCCNodes)
+      SCCIndex[N->getId()] = SCCs.size();
+    CallGraphSCC &SCC = SCCs.emplace_back();
+    SCC.Nodes.append(SCCNodes.begin(), SCCNodes.end());
+    SCC.IsRecursive = I.hasCycle();
+  }
+}
+
+void CallGraph::print(raw_ostream &OS) const {
+  for (const std::unique_ptr<CallGraphNode> &N : llvm::drop_begin(Nodes)) {
+    OS << "  ";
+    N->printName(OS);
+    OS << " calls:";
+    for (CallGraphNode *Callee : N->callees()) {
+      OS << " ";
+      Callee->printName(OS);
+    }
+    OS << "\n";
+  }
+
+  OS << "SCCs, callees first:\n";
+  for (const CallGraphSCC &SCC : SCCs) {
+    OS << "  {";
+    for (CallGraphNode *N : SCC.Nodes) {
+      OS << (N == SCC.Nodes.front() ? "" : ", ");
+      N->printName(OS);
+    }
+    OS << "}" << (SCC.IsRecursive ? " recursive" : "") << "\n";
+  }
+}
+
+void CallGraph::dump() const { print(llvm::errs()); }
+} // namespace chocopy
@@ -0,0 +1,406 @@
+module;
+
+#include <llvm/Support/ErrorHandling.h>
+
+module Analysis;
+import :CFG;
+import :ConstantPropagation;
+import :Dataflow;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+ConstantValue ConstantValue::meet(const ConstantValue &A,
+                                  const ConstantValue &B) {
+  if (A.isUndefined())
+    return B;
+  if (B.isUndefined() || A == B)
+    return A;
+  return getOverdefined();
+}
+
+bool ConstantValue::operator==(const ConstantValue &Other) const {
+  if (K != Other.K)
+    return false;
+  switch (K) {
+  case Kind::Int:
+    return IntVal == Other.IntVal;
+  case Kind::Bool:
+    return BoolVal == Other.BoolVal;
+  case Kind::Str:
+    return StrVal == Other.StrVal;
+  case Kind::Undefined:
+  case Kind::None:
+  case Kind::Overdefined:
+    return true;
+  }
+  llvm_unreachable("Unknown constant kind");
+}
+
+void ConstantValue::print(raw_ostream &OS) const {
+  switch (K) {
+  case Kind::Undefined:
+    OS << "undef";
+    break;
+  case Kind::Int:
+    OS << IntVal;
+    break;
+  case Kind::Bool:
+    OS << (BoolVal ? "True" : "False");
+    break;
+  case Kind::Str:
+    OS << '"' << StrVal << '"';
+    break;
+  case Kind::None:
+    OS << "None";
+    break;
+  case Kind::Overdefined:
+    OS << "overdefined";
+    break;
+  }
+}
+
+namespace {
+class GlobalNameCollector : public RecursiveASTVisitor<GlobalNameCollector> {
+public:
+  explicit GlobalNameCollector(llvm::DenseSet<const SymbolInfo *> &Names)
+      : Names(Names) {}
+
+  bool visitGlobalDecl(GlobalDecl *D) {
+    Names.insert(D->getSymbolInfo());
+    return true;
+  }
+
+  bool visitNonLocalDecl(NonLocalDecl *D) {
+    Names.insert(D->getSymbolInfo());
+    return true;
+  }
+
+  // Only declarations declare names.
+  bool traverseStmt(Stmt *) { return true; }
+
+private:
+  llvm::DenseSet<const SymbolInfo *> &Names;
+};
+} // namespace
+
+/// ChocoPy integers are 32 bits wide and wrap around, like the code emitted
+/// for them.
+static std::int32_t wrapInt(std::int64_t V) {
+  return static_cast<std::int32_t>(static_cast<std::uint32_t>(V));
+}
+
+static ConstantValue evaluateLiteral(const Literal *L) {
+  return llvm::TypeSwitch<const Literal *, ConstantValue>(L)
+      .Case([](const BooleanLiteral *B) {
+        return ConstantValue::getBool(B->getValue());
+      })
+      .Case([](const IntegerLiteral *I) {
+        return ConstantValue::getInt(wrapInt(I->getValue()));
+      })
+      .Case([](const StringLiteral *S) {
+        return ConstantValue::getStr(S->getValue());
+      })
+      .Case([](const NoneLiteral *) { return ConstantValue::getNone(); });
+}
+
+ConstantPropagation::ConstantPropagation(
+    const CFG &Cfg, const llvm::DenseSet<const SymbolInfo *> &CallClobbered)
+    : Cfg(Cfg), DefUse(Cfg) {
+  // Variables declared by the CFG start with their initializer, any other
+  // name is unknown. Calls may write the names that are not local.
+  llvm::DenseMap<const SymbolInfo *, const Literal *> Initializers;
+  llvm::DenseSet<const SymbolInfo *> Params;
+  for (Declaration *D : Cfg.getDeclarations())
+    if (auto *V = dyn_cast<VarDef>(D))
+      Initializers[V->getSymbolInfo()] = V->getValue();
+  if (FuncDef *F = Cfg.getFunction())
+    for (ParamDecl *P : F->getParams())
+      Params.insert(P->getSymbolInfo());
+
+  unsigned NumVars = DefUse.getNumVariables();
+  EntryState.assign(NumVars, ConstantValue::getOverdefined());
+  ClobberedVars.resize(NumVars);
+  for (unsigned Var = 0; Var != NumVars; ++Var) {
+    const SymbolInfo *SI = DefUse.getVariable(Var);
+    auto It = Initializers.find(SI);
+    if (It != Initializers.end())
+      EntryState[Var] = evaluateLiteral(It->second);
+    bool IsLocal = It != Initializers.end() || Params.contains(SI);
+    if (!IsLocal || CallClobbered.contains(SI))
+      ClobberedVars.set(Var);
+  }
+
+  for (const CFGBlock *B : Cfg) {
+    for (CFGElement El : *B) {
+      if (!El.isStmt())
+        continue;
+      StmtBlocks[El.getStmt()] = B;
+      if (auto *A = dyn_cast<AssignStmt>(El.getStmt()))
+        Targets.insert(A->getTargets().begin(), A->getTargets().end());
+    }
+    if (Stmt *S = B->getTerminator().getStmt()) {
+      StmtBlocks[S] = B;
+      if (auto *F = dyn_cast<ForStmt>(S))
+        Targets.insert(F->getTarget());
+    }
+  }
+
+  solve();
+}
+
+llvm::DenseSet<const SymbolInfo *>
+ConstantPropagation::collectCallClobberedNames(Program *P) {
+  llvm::DenseSet<const SymbolInfo *> Names;
+  GlobalNameCollector(Names).traverseProgram(P);
+  return Names;
+}
+
+bool ConstantPropagation::isExecuted(const Stmt *S) const {
+  if (auto *E = dyn_cast<ExprStmt>(S))
+    return isExecuted(E->getExpr());
+  const CFGBlock *B = StmtBlocks.lookup(S);
+  return B && isReachable(*B);
+}
+
+void ConstantPropagation::solve() {
+  unsigned NumBlocks = Cfg.size();
+  Reachable.resize(NumBlocks);
+  ExitStates.resize(NumBlocks);
+
+  SmallVector<const CFGBlock *, 0> Worklist;
+  llvm::BitVector InWorklist(NumBlocks);
+  auto Push = [&](const CFGBlock *B) {
+    if (!InWorklist.test(B->getBlockId())) {
+      InWorklist.set(B->getBlockId());
+      Worklist.push_back(B);
+    }
+  };
+
+  Reachable.set(Cfg.getEntry().getBlockId());
+  Push(&Cfg.getEntry());
+  while (!Worklist.empty()) {
+    const CFGBlock *B = Worklist.pop_back_val();
+    InWorklist.reset(B->getBlockId());
+    bool Changed = visitBlock(*B);
+
+    // Both successors of a branch are taken, unless its condition, the last
+    // expression evaluated in the block, is a constant.
+    auto Succs = B->succs();
+    if (B->succ_size() == 2 && !B->empty() && B->back().isExpr() &&
+        !isa_and_present<ForStmt>(B->getTerminator().getStmt())) {
+      ConstantValue Cond = getValue(B->back().getExpr());
+      if (Cond.isUndefined())
+        continue;
+      if (Cond.isBool()) {
+        auto Taken = B->succ_begin() + (Cond.getBoolValue() ? 0 : 1);
+        Succs = llvm::make_range(Taken, Taken + 1);
+      }
+    }
+
+    for (const CFGBlock *Succ : Succs) {
+      bool NewEdge =
+          ExecutableEdges.insert({B->getBlockId(), Succ->getBlockId()}).second;
+      if (NewEdge)
+        Reachable.set(Succ->getBlockId());
+      if (NewEdge || Changed)
+        Push(Succ);
+    }
+  }
+}
+
+bool ConstantPropagation::visitBlock(const CFGBlock &B) {
+  State S;
+  if (&B == &Cfg.getEntry()) {
+    S = EntryState;
+  } else {
+    S.assign(DefUse.getNumVariables(), ConstantValue());
+    for (const CFGBlock *P : B.preds()) {
+      if (!isEdgeExecutable(*P, B))
+        continue;
+      const State &PredExit = ExitStates[P->getBlockId()];
+      for (unsigned Var = 0, E = S.size(); Var != E; ++Var)
+        S[Var] = ConstantValue::meet(S[Var], PredExit[Var]);
+    }
+  }
+
+  bool Changed = false;
+  for (CFGElement El : B) {
+    if (El.isStmt()) {
+      auto *A = dyn_cast<AssignStmt>(El.getStmt());
+      if (!A)
+        continue;
+      ConstantValue V = getValue(A->getValue());
+      for (Expr *T : A->getTargets())
+        if (auto *D = dyn_cast<DeclRef>(T))
+          if (auto Var = DefUse.getVariableIndex(D->getSymbolInfo()))
+            S[*Var] = V;
+      continue;
+    }
+
+    const Expr *E = El.getExpr();
+    if (Targets.contains(E))
+      continue;
+    ConstantValue V = evaluate(E, S);
+    ConstantValue &Old = ExprValues[E];
+    if (Old != V) {
+      Old = V;
+      Changed = true;
+    }
+    if (isa<CallExpr, MethodCallExpr>(E))
+      for (unsigned Var : ClobberedVars.set_bits())
+        S[Var] = ConstantValue::getOverdefined();
+  }
+
+  if (auto *F = dyn_cast_if_present<ForStmt>(B.getTerminator().getStmt()))
+    if (auto Var = DefUse.getVariableIndex(F->getTarget()->getSymbolInfo()))
+      S[*Var] = ConstantValue::getOverdefined();
+
+  State &Exit = ExitStates[B.getBlockId()];
+  if (Exit != S) {
+    Exit = std::move(S);
+    Changed = true;
+  }
+  return Changed;
+}
+
+ConstantValue ConstantPropagation::evaluate(const Expr *E, const State &S) {
+  // Operands are evaluated before the expressions using them, possibly in
+  // other blocks for the branches of and, or and if expressions.
+  return llvm::TypeSwitch<const Expr *, ConstantValue>(E)
+      .Case([](const Literal *L) { return evaluateLiteral(L); })
+      .Case([&](const DeclRef *D) {
+        if (auto Var = DefUse.getVariableIndex(D->getSymbolInfo()))
+          return S[*Var];
+        return ConstantValue::getOverdefined();
+      })
+      .Case([&](const UnaryExpr *U) {
+        ConstantValue V = getValue(U->getOperand());
+        if (U->getOpKind() == UnaryExpr::OpKind::Minus && V.isInt())
+          return ConstantValue::getInt(wrapInt(-std::int64_t(V.getIntValue())));
+        if (U->getOpKind() == UnaryExpr::OpKind::Not && V.isBool())
+          return ConstantValue::getBool(!V.getBoolValue());
+        return V.isUndefined() ? V : ConstantValue::getOverdefined();
+      })
+      .Case([&](const BinaryExpr *B) { return evaluateBinary(B); })
+      .Case([&](const IfExpr *I) {
+        ConstantValue Cond = getValue(I->getCondExpr());
+        if (Cond.isUndefined())
+          return Cond;
+        if (Cond.isBool())
+          return getValue(Cond.getBoolValue() ? I->getThenExpr()
+                                              : I->getElseExpr());
+        // Even if both branches agree, the condition must still run for
+        // its side effects: a constant stands for the whole expression.
+        return ConstantValue::getOverdefined();
+      })
+      .Default([](const Expr *) { return ConstantValue::getOverdefined(); });
+}
+
+ConstantValue ConstantPropagation::evaluateBinary(const BinaryExpr *B) {
+  using OpKind = BinaryExpr::OpKind;
+  OpKind Op = B->getOpKind();
+  ConstantValue L = getValue(B->getLeft());
+  ConstantValue R = getValue(B->getRight());
+
+  // The right operand is evaluated only if the left one does not decide.
+  if (Op == OpKind::And || Op == OpKind::Or) {
+    if (L.isUndefined())
+      return L;
+    if (!L.isBool())
+      return ConstantValue::getOverdefined();
+    return L.getBoolValue() == (Op == OpKind::Or) ? L : R;
+  }
+
+  if (L.isUndefined() || R.isUndefined())
+    return ConstantValue();
+  if (!L.isConstant() || !R.isConstant())
+    return ConstantValue::getOverdefined();
+
+  if (L.isStr() && R.isStr() && Op == OpKind::Add) {
+    SmallString<64> Str(L.getStrValue());
+    Str += R.getStrValue();
+    return ConstantValue::getStr(saveString(Str));
+  }
+
+  if (Op == OpKind::EqCmp || Op == OpKind::NEqCmp) {
+    if (L.getKind() != R.getKind() || L.isNone())
+      return ConstantValue::getOverdefined();
+    return ConstantValue::getBool((L == R) == (Op == OpKind::EqCmp));
+  }
+
+  if (!L.isInt() || !R.isInt())
+    return ConstantValue::getOverdefined();
+
+  std::int64_t A = L.getIntValue();
+  std::int64_t C = R.getIntValue();
+  switch (Op) {
+  case OpKind::Add:
+    return ConstantValue::getInt(wrapInt(A + C));
+  case OpKind::Sub:
+    return ConstantValue::getInt(wrapInt(A - C));
+  case OpKind::Mul:
+    return ConstantValue::getInt(wrapInt(A * C));
+  case OpKind::FloorDiv: {
+    // Division by zero raises at run time.
+    if (C == 0)
+      return ConstantValue::getOverdefined();
+    std::int64_t Q = A / C;
+    if (A % C != 0 && (A < 0) != (C < 0))
+      --Q;
+    return ConstantValue::getInt(wrapInt(Q));
+  }
+  case OpKind::Mod: {
+    if (C == 0)
+      return ConstantValue::getOverdefined();
+    std::int64_t M = A % C;
+    if (M != 0 && (M < 0) != (C < 0))
+      M += C;
+    return ConstantValue::getInt(wrapInt(M));
+  }
+  case OpKind::LEqCmp:
+    return ConstantValue::getBool(A <= C);
+  case OpKind::GEqCmp:
+    return ConstantValue::getBool(A >= C);
+  case OpKind::LCmp:
+    return ConstantValue::getBool(A < C);
+  case OpKind::GCmp:
+    return ConstantValue::getBool(A > C);
+  case OpKind::Is:
+    return ConstantValue::getOverdefined();
+  case OpKind::And:
+  case OpKind::Or:
+  case OpKind::EqCmp:
+  case OpKind::NEqCmp:
+    break;
+  }
+  llvm_unreachable("Operator handled above");
+}
+
+StringRef ConstantPropagation::saveString(StringRef Str) {
+  char *Data = Strings.Allocate<char>(Str.size());
+  std::copy(Str.begin(), Str.end(), Data);
+  return StringRef(Data, Str.size());
+}
+
+void ConstantPropagation::dump(raw_ostream &OS) const {
+  for (const CFGBlock *B : Cfg) {
+    B->printAsOperand(OS, false);
+    OS << ":";
+    if (!isReachable(*B)) {
+      OS << " unreachable\n";
+      continue;
+    }
+    OS << "\n  constants at exit:";
+    const State &Exit = ExitStates[B->getBlockId()];
+    for (unsigned Var = 0, E = Exit.size(); Var != E; ++Var) {
+      if (!Exit[Var].isConstant())
+        continue;
+      OS << " " << DefUse.getVariable(Var)->getName() << "=";
+      Exit[Var].print(OS);
+    }
+    OS << "\n";
+  }
+}
+} // namespace chocopy
@@ -0,0 +1,206 @@
+module Analysis;
+import :CFG;
+import :Dataflow;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+CFGDefUse::CFGDefUse(const CFG &Cfg) {
+  // Targets are visited before the statement that writes them, so they are
+  // collected first.
+  llvm::DenseSet<const Expr *> Targets;
+  for (const CFGBlock *B : Cfg) {
+    for (CFGElement El : *B)
+      if (El.isStmt())
+        if (auto *A = dyn_cast<AssignStmt>(El.getStmt()))
+          for (Expr *T : A->getTargets())
+            Targets.insert(T);
+    if (auto *F = dyn_cast_if_present<ForStmt>(B->getTerminator().getStmt()))
+      Targets.insert(F->getTarget());
+  }
+
+  BlockStart.reserve(Cfg.size() + 1);
+  for (const CFGBlock *B : Cfg) {
+    BlockStart.push_back(Accesses.size());
+    for (CFGElement El : *B) {
+      if (El.isExpr()) {
+        auto *DR = dyn_cast<DeclRef>(El.getExpr());
+        if (DR && !Targets.contains(DR))
+          addAccess(DR, /*IsDef=*/false);
+        continue;
+      }
+      if (auto *A = dyn_cast<AssignStmt>(El.getStmt()))
+        for (Expr *T : A->getTargets())
+          if (auto *DR = dyn_cast<DeclRef>(T))
+            addAccess(DR, /*IsDef=*/true);
+    }
+    // The loop variable is written each time the header branches.
+    if (auto *F = dyn_cast_if_present<ForStmt>(B->getTerminator().getStmt()))
+      addAccess(F->getTarget(), /*IsDef=*/true);
+  }
+  BlockStart.push_back(Accesses.size());
+
+  FirstEntryDef = Defs.size();
+  if (FuncDef *F = Cfg.getFunction())
+    for (ParamDecl *P : F->getParams())
+      addEntryDef(P);
+  for (Declaration *D : Cfg.getDeclarations())
+    if (isa<VarDef>(D))
+      addEntryDef(D);
+}
+
+std::optional<unsigned>
+CFGDefUse::getVariableIndex(const SymbolInfo *SI) const {
+  auto It = VarIndex.find(SI);
+  if (It == VarIndex.end())
+    return std::nullopt;
+  return It->second;
+}
+
+void CFGDefUse::addAccess(const DeclRef *Ref, bool IsDef) {
+  if (isa_and_present<FuncDef, ClassDef>(Ref->getDeclInfo()))
+    return;
+
+  auto [It, Inserted] =
+      VarIndex.try_emplace(Ref->getSymbolInfo(), Variables.size());
+  if (Inserted) {
+    Variables.push_back(Ref->getSymbolInfo());
+    VarDefs.emplace_back();
+  }
+
+  unsigned Var = It->second;
+  unsigned Def = NoDef;
+  if (IsDef) {
+    Def = Defs.size();
+    Defs.push_back(Accesses.size());
+    VarDefs[Var].push_back(Def);
+  }
+  Accesses.push_back(Access{Var, Def, Ref});
+}
+
+void CFGDefUse::addEntryDef(const Declaration *D) {
+  // A name the CFG never accesses needs no definition.
+  auto It = VarIndex.find(D->getSymbolInfo());
+  if (It == VarIndex.end())
+    return;
+
+  unsigned Var = It->second;
+  unsigned Def = Defs.size();
+  Defs.push_back(Accesses.size());
+  VarDefs[Var].insert(VarDefs[Var].begin(), Def);
+  Accesses.push_back(Access{Var, Def, nullptr});
+}
+
+BitVectorDataflow::BitVectorDataflow(const CFG &Cfg, unsigned NumBits,
+                                     Direction Dir, MeetOp Meet)
+    : Cfg(Cfg), NumBits(NumBits), Dir(Dir), Meet(Meet), Boundary(NumBits) {
+  Blocks.resize(Cfg.size());
+  for (BlockState &S : Blocks) {
+    S.Gen.resize(NumBits);
+    S.Kill.resize(NumBits);
+  }
+}
+
+unsigned BitVectorDataflow::solve() {
+  // The top of an intersection is the full set.
+  for (BlockState &S : Blocks) {
+    S.In = llvm::BitVector(NumBits);
+    S.Out = llvm::BitVector(NumBits, Meet == MeetOp::Intersection);
+  }
+
+  SmallVector<const CFGBlock *, 0> Order = computeOrder();
+  SmallVector<unsigned, 0> Priority(Blocks.size(), ~0u);
+  for (unsigned I = 0, E = Order.size(); I != E; ++I)
+    Priority[Order[I]->getBlockId()] = I;
+
+  // Lower positions in Order are taken first.
+  std::priority_queue<unsigned, SmallVector<unsigned, 0>, std::greater<>>
+      Worklist;
+  llvm::BitVector Queued(Order.size(), true);
+  for (unsigned I = 0, E = Order.size(); I != E; ++I)
+    Worklist.push(I);
+
+  unsigned NumTransfers = 0;
+  llvm::BitVector NewOut;
+  while (!Worklist.empty()) {
+    unsigned Idx = Worklist.top();
+    Worklist.pop();
+    Queued.reset(Idx);
+
+    const CFGBlock &B = *Order[Idx];
+    BlockState &S = Blocks[B.getBlockId()];
+    computeIn(B, S.In);
+    NewOut = S.In;
+    NewOut.reset(S.Kill);
+    NewOut |= S.Gen;
+    ++NumTransfers;
+    if (NewOut == S.Out)
+      continue;
+
+    std::swap(S.Out, NewOut);
+    auto Dependents = Dir == Direction::Forward ? B.succs() : B.preds();
+    for (const CFGBlock *D : Dependents) {
+      unsigned P = Priority[D->getBlockId()];
+      if (P != ~0u && !Queued.test(P)) {
+        Queued.set(P);
+        Worklist.push(P);
+      }
+    }
+  }
+  return NumTransfers;
+}
+
+SmallVector<const CFGBlock *, 0> BitVectorDataflow::computeOrder() const {
+  // Iterative depth-first search from the entry, so that deep CFGs do not
+  // overflow the stack.
+  SmallVector<const CFGBlock *, 0> PostOrder;
+  SmallVector<std::pair<const CFGBlock *, CFGBlock::const_succ_iterator>, 16>
+      Stack;
+  llvm::BitVector Visited(Blocks.size());
+
+  const CFGBlock *Entry = &Cfg.getEntry();
+  Visited.set(Entry->getBlockId());
+  Stack.emplace_back(Entry, Entry->succ_begin());
+  while (!Stack.empty()) {
+    auto &[B, It] = Stack.back();
+    if (It == B->succ_end()) {
+      PostOrder.push_back(B);
+      Stack.pop_back();
+      continue;
+    }
+    const CFGBlock *S = *It++;
+    if (!Visited.test(S->getBlockId())) {
+      Visited.set(S->getBlockId());
+      Stack.emplace_back(S, S->succ_begin());
+    }
+  }
+
+  if (Dir == Direction::Forward)
+    std::reverse(PostOrder.begin(), PostOrder.end());
+  return PostOrder;
+}
+
+void BitVectorDataflow::computeIn(const CFGBlock &B,
+                                  llvm::BitVector &In) const {
+  bool IsBoundary = Dir == Direction::Forward ? &B == &Cfg.getEntry()
+                                              : &B == &Cfg.getExit();
+  if (IsBoundary) {
+    In = Boundary;
+    return;
+  }
+
+  In.reset();
+  bool First = true;
+  for (const CFGBlock *N : Dir == Direction::Forward ? B.preds() : B.succs()) {
+    const llvm::BitVector &Out = Blocks[N->getBlockId()].Out;
+    if (First)
+      In = Out;
+    else if (Meet == MeetOp::Union)
+      In |= Out;
+    else
+      In &= Out;
+    First = false;
+  }
+}
+} // namespace chocopy
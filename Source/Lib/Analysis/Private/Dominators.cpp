@@ -0,0 +1,54 @@
+module;
+
+#include "llvm/Support/GenericDomTreeConstruction.h"
+#include "llvm/Support/GenericLoopInfoImpl.h"
+
+module Analysis;
+import :CFG;
+import :Dominators;
+import AST;
+import Basic;
+import std;
+
+template void
+llvm::DomTreeBuilder::Calculate<chocopy::CFGDomTree>(chocopy::CFGDomTree &DT);
+template void llvm::DomTreeBuilder::Calculate<chocopy::CFGPostDomTree>(
+    chocopy::CFGPostDomTree &DT);
+
+template class llvm::LoopBase<chocopy::CFGBlock, chocopy::CFGLoop>;
+template class llvm::LoopInfoBase<chocopy::CFGBlock, chocopy::CFGLoop>;
+
+namespace chocopy {
+Stmt *CFGLoop::getLoopStmt() const {
+  Stmt *S = getHeader()->getTerminator().getStmt();
+  if (isa_and_present<WhileStmt, ForStmt>(S))
+    return S;
+  return nullptr;
+}
+
+CFGLoopAnalysis::CFGLoopAnalysis(CFG &Cfg) : Cfg(Cfg) {
+  DT.recalculate(Cfg);
+  PDT.recalculate(Cfg);
+  LI.analyze(DT);
+}
+
+CFGBlock *CFGLoopAnalysis::getImmediatePostDominator(const CFGBlock &B) const {
+  // The roots hang off a virtual node without a block.
+  const CFGDomTreeNode *N = PDT.getNode(&B);
+  if (!N || !N->getIDom())
+    return nullptr;
+  return N->getIDom()->getBlock();
+}
+
+void CFGLoopAnalysis::dumpPostDomTree(raw_ostream &OS) const {
+  for (const CFGBlock *B : Cfg) {
+    B->printAsOperand(OS, false);
+    OS << ":";
+    if (CFGBlock *IPDom = getImmediatePostDominator(*B)) {
+      OS << " ";
+      IPDom->printAsOperand(OS, false);
+    }
+    OS << "\n";
+  }
+}
+} // namespace chocopy
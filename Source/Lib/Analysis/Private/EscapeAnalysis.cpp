@@ -0,0 +1,225 @@
+module Analysis;
+import :CFG;
+import :Dataflow;
+import :Dominators;
+import :EscapeAnalysis;
+import :LiveVariables;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+EscapeAnalysis::EscapeAnalysis(const CFG &Cfg, const ASTContext &Ctx,
+                               const CFGLoopAnalysis &Loops,
+                               const LiveVariables &Liveness)
+    : Ctx(Ctx), Loops(Loops), Liveness(Liveness),
+      DefUse(Liveness.getDefUse()), Locals(Cfg.collectLocalNames()) {
+  for (const CFGBlock *B : Cfg) {
+    unsigned Idx = 0;
+    for (CFGElement El : *B) {
+      if (El.isExpr())
+        Positions[El.getExpr()] = {B, Idx};
+      ++Idx;
+    }
+  }
+
+  AssignedTo.resize(DefUse.getNumVariables());
+  EscapingVars.resize(DefUse.getNumVariables());
+  for (const Stmt *S : Cfg.getBody())
+    visitStmt(S);
+  solve();
+}
+
+bool EscapeAnalysis::isLocal(const SymbolInfo *SI) const {
+  return Locals.contains(SI);
+}
+
+void EscapeAnalysis::visitStmt(const Stmt *S) {
+  llvm::TypeSwitch<const Stmt *>(S)
+      .Case([&](const AssignStmt *A) {
+        for (Expr *T : A->getTargets()) {
+          if (auto *D = dyn_cast<DeclRef>(T)) {
+            std::optional<unsigned> Var =
+                DefUse.getVariableIndex(D->getSymbolInfo());
+            visitValue(A->getValue(), Var ? *Var : Escape);
+            continue;
+          }
+          // Attributes and list elements outlive the function.
+          visitValue(A->getValue(), Escape);
+          if (auto *M = dyn_cast<MemberExpr>(T)) {
+            visitValue(M->getObject(), Discard);
+          } else if (auto *I = dyn_cast<IndexExpr>(T)) {
+            visitValue(I->getList(), Discard);
+            visitValue(I->getIndex(), Discard);
+          }
+        }
+      })
+      .Case([&](const ExprStmt *E) { visitValue(E->getExpr(), Discard); })
+      .Case([&](const ReturnStmt *R) {
+        if (Expr *V = R->getValue())
+          visitValue(V, Escape);
+      })
+      .Case([&](const IfStmt *I) {
+        visitValue(I->getCondition(), Discard);
+        for (Stmt *Then : I->getThenBody())
+          visitStmt(Then);
+        for (Stmt *Else : I->getElseBody())
+          visitStmt(Else);
+      })
+      .Case([&](const WhileStmt *W) {
+        visitValue(W->getCondition(), Discard);
+        for (Stmt *Body : W->getBody())
+          visitStmt(Body);
+      })
+      .Case([&](const ForStmt *F) {
+        // The target is assigned elements of the iterable, which are already
+        // held by it.
+        visitValue(F->getIterable(), Discard);
+        for (Stmt *Body : F->getBody())
+          visitStmt(Body);
+      });
+}
+
+void EscapeAnalysis::visitValue(const Expr *E, unsigned Target) {
+  Flows[E].push_back(Target);
+
+  llvm::TypeSwitch<const Expr *>(E)
+      .Case([&](const DeclRef *D) {
+        if (Target == Discard)
+          return;
+        std::optional<unsigned> Var =
+            DefUse.getVariableIndex(D->getSymbolInfo());
+        if (!Var)
+          return;
+        if (Target == Escape)
+          EscapingVars.set(*Var);
+        else
+          AssignedTo[*Var].push_back(Target);
+      })
+      .Case([&](const ListExpr *L) {
+        Sites.push_back(L);
+        for (Expr *El : L->getElements())
+          visitValue(El, Escape);
+      })
+      .Case([&](const CallExpr *C) {
+        auto *Callee = dyn_cast<DeclRef>(C->getFunction());
+        Declaration *D = Callee ? Callee->getDeclInfo() : nullptr;
+        if (isa_and_present<ClassDef>(D))
+          Sites.push_back(C);
+        bool KeepsArgs =
+            !D || (D != Ctx.getPrintFunc() && D != Ctx.getLenFunc());
+        visitValue(C->getFunction(), Discard);
+        for (Expr *Arg : C->getArgs())
+          visitValue(Arg, KeepsArgs ? Escape : Discard);
+      })
+      .Case([&](const MethodCallExpr *M) {
+        visitValue(M->getMethod()->getObject(), Escape);
+        for (Expr *Arg : M->getArgs())
+          visitValue(Arg, Escape);
+      })
+      .Case([&](const BinaryExpr *B) {
+        // Adding strings or lists creates a new object.
+        auto *T = dyn_cast_if_present<ValueType>(B->getInferredType());
+        if (B->getOpKind() == BinaryExpr::OpKind::Add && T && !T->isInt())
+          Sites.push_back(B);
+        visitValue(B->getLeft(), Discard);
+        visitValue(B->getRight(), Discard);
+      })
+      .Case([&](const UnaryExpr *U) { visitValue(U->getOperand(), Discard); })
+      .Case([&](const IfExpr *I) {
+        visitValue(I->getCondExpr(), Discard);
+        visitValue(I->getThenExpr(), Target);
+        visitValue(I->getElseExpr(), Target);
+      })
+      .Case([&](const IndexExpr *I) {
+        visitValue(I->getList(), Discard);
+        visitValue(I->getIndex(), Discard);
+      })
+      .Case([&](const MemberExpr *M) { visitValue(M->getObject(), Discard); });
+}
+
+void EscapeAnalysis::solve() {
+  for (unsigned Var = 0, E = DefUse.getNumVariables(); Var != E; ++Var)
+    if (!isLocal(DefUse.getVariable(Var)))
+      EscapingVars.set(Var);
+
+  // A local escapes if it is assigned to one that does.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned Var = 0, E = AssignedTo.size(); Var != E; ++Var) {
+      if (EscapingVars.test(Var))
+        continue;
+      if (llvm::any_of(AssignedTo[Var],
+                       [&](unsigned To) { return EscapingVars.test(To); })) {
+        EscapingVars.set(Var);
+        Changed = true;
+      }
+    }
+  }
+}
+
+bool EscapeAnalysis::mayEscape(const Expr *E) const {
+  auto It = Flows.find(E);
+  if (It == Flows.end())
+    return true;
+  return llvm::any_of(It->second, [&](unsigned Target) {
+    return Target == Escape || (Target != Discard && EscapingVars.test(Target));
+  });
+}
+
+bool EscapeAnalysis::canAllocateOnStack(const Expr *E) const {
+  auto Pos = Positions.find(E);
+  if (Pos == Positions.end() || mayEscape(E))
+    return false;
+  CFGLoop *L = Loops.getLoopFor(*Pos->second.first);
+  if (!L)
+    return true;
+
+  // The locals that may hold the object.
+  llvm::BitVector Holders(DefUse.getNumVariables());
+  SmallVector<unsigned, 8> Worklist;
+  for (unsigned Target : Flows.find(E)->second)
+    if (Target != Discard && !Holders.test(Target)) {
+      Holders.set(Target);
+      Worklist.push_back(Target);
+    }
+  while (!Worklist.empty())
+    for (unsigned To : AssignedTo[Worklist.pop_back_val()])
+      if (!Holders.test(To)) {
+        Holders.set(To);
+        Worklist.push_back(To);
+      }
+
+  // The next evaluation would overwrite the object while it is still in use.
+  for (; L; L = L->getParentLoop())
+    if (Liveness.getLiveAtEntry(*L->getHeader()).anyCommon(Holders))
+      return false;
+  return true;
+}
+
+void EscapeAnalysis::dump(raw_ostream &OS) const {
+  for (const Expr *E : Sites) {
+    OS << "  ";
+    auto Pos = Positions.find(E);
+    if (Pos != Positions.end()) {
+      Pos->second.first->printAsOperand(OS, false);
+      OS << "." << Pos->second.second << " ";
+    }
+    if (isa<ListExpr>(E))
+      OS << "list";
+    else if (isa<CallExpr>(E))
+      OS << "object";
+    else
+      OS << "concatenation";
+    OS << ": ";
+    if (canAllocateOnStack(E))
+      OS << "stack";
+    else if (mayEscape(E))
+      OS << "escapes";
+    else
+      OS << "heap, live across iterations";
+    OS << "\n";
+  }
+}
+} // namespace chocopy
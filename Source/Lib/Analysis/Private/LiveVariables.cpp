@@ -0,0 +1,73 @@
+module Analysis;
+import :CFG;
+import :Dataflow;
+import :LiveVariables;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+LiveVariables::LiveVariables(const CFG &Cfg)
+    : Cfg(Cfg), DefUse(Cfg),
+      Dataflow(Cfg, DefUse.getNumVariables(),
+               BitVectorDataflow::Direction::Backward,
+               BitVectorDataflow::MeetOp::Union),
+      DeadDefs(DefUse.getNumDefs()) {
+  // A block generates the names it reads before writing them and kills the
+  // names it writes.
+  for (const CFGBlock *B : Cfg) {
+    llvm::BitVector &Gen = Dataflow.getGen(*B);
+    llvm::BitVector &Kill = Dataflow.getKill(*B);
+    for (const CFGDefUse::Access &A : DefUse.getAccesses(*B)) {
+      if (A.isDef())
+        Kill.set(A.Var);
+      else if (!Kill.test(A.Var))
+        Gen.set(A.Var);
+    }
+  }
+  Dataflow.solve();
+
+  // A write is dead if its name is not live right after it.
+  llvm::BitVector Live;
+  for (const CFGBlock *B : Cfg) {
+    Live = getLiveAtExit(*B);
+    for (const CFGDefUse::Access &A : llvm::reverse(DefUse.getAccesses(*B))) {
+      if (A.isDef()) {
+        if (!Live.test(A.Var))
+          DeadDefs.set(A.Def);
+        Live.reset(A.Var);
+      } else {
+        Live.set(A.Var);
+      }
+    }
+  }
+}
+
+bool LiveVariables::isLiveAtEntry(const CFGBlock &B,
+                                  const SymbolInfo *SI) const {
+  std::optional<unsigned> Var = DefUse.getVariableIndex(SI);
+  return Var && getLiveAtEntry(B).test(*Var);
+}
+
+bool LiveVariables::isLiveAtExit(const CFGBlock &B,
+                                 const SymbolInfo *SI) const {
+  std::optional<unsigned> Var = DefUse.getVariableIndex(SI);
+  return Var && getLiveAtExit(B).test(*Var);
+}
+
+void LiveVariables::dump(raw_ostream &OS) const {
+  auto PrintSet = [&](StringRef Label, const llvm::BitVector &Set) {
+    OS << "  " << Label << ":";
+    for (unsigned Var : Set.set_bits())
+      OS << " " << DefUse.getVariable(Var)->getName();
+    OS << "\n";
+  };
+
+  for (const CFGBlock *B : Cfg) {
+    B->printAsOperand(OS, false);
+    OS << ":\n";
+    PrintSet("live at entry", getLiveAtEntry(*B));
+    PrintSet("live at exit", getLiveAtExit(*B));
+  }
+}
+} // namespace chocopy
@@ -0,0 +1,95 @@
+module;
+
+#include <cassert>
+
+module Analysis;
+import :CFG;
+import :CFGCache;
+import :CallGraph;
+import :ConstantPropagation;
+import :ProgramAnalysis;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+void CFGAnalyses::print(raw_ostream &OS) const {
+  Cfg.print(OS);
+  OS << "Loops:\n";
+  Loops.getLoopInfo().print(OS);
+  OS << "Post-dominators:\n";
+  Loops.dumpPostDomTree(OS);
+  OS << "Live variables:\n";
+  Liveness.dump(OS);
+  OS << "Reaching definitions:\n";
+  ReachingDefs.dump(OS);
+  OS << "Constants:\n";
+  Constants.dump(OS);
+  OS << "Allocations:\n";
+  Escapes.dump(OS);
+  OS << "Variable usage:\n";
+  Usage.dump(OS);
+}
+
+void ProgramAnalysis::parallelFor(
+    std::size_t N, llvm::function_ref<void(std::size_t)> Fn) const {
+  llvm::DefaultThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  std::atomic<std::size_t> Next = 0;
+  std::size_t NumWorkers = std::min<std::size_t>(Pool.getMaxConcurrency(), N);
+  for (std::size_t I = 0; I != NumWorkers; ++I)
+    Pool.async([&] {
+      for (std::size_t J; (J = Next++) < N;)
+        Fn(J);
+    });
+  Pool.wait();
+}
+
+void ProgramAnalysis::run() {
+  ArrayRef<FuncDef *> Functions = Cache.getFunctions();
+  Results.clear();
+  Results.resize(Functions.size() + 1);
+  llvm::DenseSet<const SymbolInfo *> CallClobbered =
+      ConstantPropagation::collectCallClobberedNames(Cache.getProgram());
+  Calls = std::make_unique<CallGraph>(Cache.getProgram());
+  // Every task builds and analyzes a CFG of its own, writing only its slot.
+  parallelFor(Results.size(), [&](std::size_t I) {
+    CFG &Cfg = I == Functions.size() ? Cache.getTopLevelCFG()
+                                     : Cache.getCFG(Functions[I]);
+    Results[I] = std::make_unique<CFGAnalyses>(Cfg, Ctx, CallClobbered);
+  });
+}
+
+const CFGAnalyses &ProgramAnalysis::getAnalyses(FuncDef *F) const {
+  assert(!Results.empty() && "analyses were not run");
+  return *Results[Cache.getFunctionIndex(F)];
+}
+
+void ProgramAnalysis::emitWarnings(DiagnosticsEngine &Diags) const {
+  assert(!Results.empty() && "analyses were not run");
+  for (const std::unique_ptr<CFGAnalyses> &R : Results)
+    R->getUsage().emitWarnings(Diags);
+}
+
+void ProgramAnalysis::print(raw_ostream &OS) const {
+  assert(!Results.empty() && "analyses were not run");
+  ArrayRef<FuncDef *> Functions = Cache.getFunctions();
+
+  // Printing a CFG is about as costly as building it, so the output of each
+  // is rendered concurrently and then written in order.
+  SmallVector<std::string, 0> Outputs(Results.size());
+  parallelFor(Results.size(), [&](std::size_t I) {
+    llvm::raw_string_ostream Out(Outputs[I]);
+    Out.enable_colors(OS.has_colors());
+    if (I == Functions.size())
+      Out << "<top level>:\n";
+    else
+      Out << "def " << Functions[I]->getName() << ":\n";
+    Results[I]->print(Out);
+  });
+
+  for (const std::string &Out : Outputs)
+    OS << Out;
+  OS << "Call graph:\n";
+  Calls->print(OS);
+}
+} // namespace chocopy
@@ -0,0 +1,73 @@
+module Analysis;
+import :CFG;
+import :Dataflow;
+import :ReachingDefinitions;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+ReachingDefinitions::ReachingDefinitions(const CFG &Cfg)
+    : Cfg(Cfg), DefUse(Cfg),
+      Dataflow(Cfg, DefUse.getNumDefs(), BitVectorDataflow::Direction::Forward,
+               BitVectorDataflow::MeetOp::Union) {
+  // A block generates the last write of each name it writes and kills all
+  // the other writes of these names.
+  llvm::BitVector Written(DefUse.getNumVariables());
+  for (const CFGBlock *B : Cfg) {
+    llvm::BitVector &Gen = Dataflow.getGen(*B);
+    llvm::BitVector &Kill = Dataflow.getKill(*B);
+    for (const CFGDefUse::Access &A :
+         llvm::reverse(DefUse.getAccesses(*B))) {
+      if (!A.isDef() || Written.test(A.Var))
+        continue;
+      Written.set(A.Var);
+      Gen.set(A.Def);
+      for (unsigned D : DefUse.getDefsOf(A.Var))
+        Kill.set(D);
+    }
+    Written.reset();
+  }
+
+  llvm::BitVector OnEntry(DefUse.getNumDefs());
+  OnEntry.set(DefUse.getFirstEntryDef(), DefUse.getNumDefs());
+  Dataflow.setBoundary(std::move(OnEntry));
+  Dataflow.solve();
+}
+
+SmallVector<unsigned, 4>
+ReachingDefinitions::getReachingDefs(const CFGBlock &B, std::size_t Idx) const {
+  ArrayRef<CFGDefUse::Access> Accesses = DefUse.getAccesses(B);
+  unsigned Var = Accesses[Idx].Var;
+
+  // A write earlier in the block hides all the others.
+  for (std::size_t I = Idx; I-- != 0;)
+    if (Accesses[I].isDef() && Accesses[I].Var == Var)
+      return {Accesses[I].Def};
+
+  SmallVector<unsigned, 4> Defs;
+  const llvm::BitVector &Reaching = getReachingAtEntry(B);
+  for (unsigned D : DefUse.getDefsOf(Var))
+    if (Reaching.test(D))
+      Defs.push_back(D);
+  return Defs;
+}
+
+void ReachingDefinitions::dump(raw_ostream &OS) const {
+  auto PrintSet = [&](StringRef Label, const llvm::BitVector &Set) {
+    OS << "  " << Label << ":";
+    for (unsigned D : Set.set_bits()) {
+      const CFGDefUse::Access &A = DefUse.getDef(D);
+      OS << " " << DefUse.getVariable(A.Var)->getName() << "#" << D;
+    }
+    OS << "\n";
+  };
+
+  for (const CFGBlock *B : Cfg) {
+    B->printAsOperand(OS, false);
+    OS << ":\n";
+    PrintSet("reaching at entry", getReachingAtEntry(*B));
+    PrintSet("reaching at exit", getReachingAtExit(*B));
+  }
+}
+} // namespace chocopy
@@ -0,0 +1,65 @@
+module Analysis;
+import :CFG;
+import :Dataflow;
+import :LiveVariables;
+import :VariableUsage;
+import AST;
+import Basic;
+import std;
+
+namespace chocopy {
+VariableUsage::VariableUsage(const CFG &Cfg, const LiveVariables &Liveness) {
+  const CFGDefUse &DefUse = Liveness.getDefUse();
+  llvm::DenseSet<const SymbolInfo *> Locals = Cfg.collectLocalNames();
+
+  for (Declaration *D : Cfg.getDeclarations())
+    if (auto *V = dyn_cast<VarDef>(D);
+        V && Locals.contains(V->getSymbolInfo()) &&
+        !DefUse.getVariableIndex(V->getSymbolInfo()))
+      Unused.push_back(V);
+
+  // Code that never runs is not worth a warning about what it stores.
+  llvm::BitVector Reachable(Cfg.size());
+  SmallVector<const CFGBlock *, 16> Worklist = {&Cfg.getEntry()};
+  Reachable.set(Cfg.getEntry().getBlockId());
+  while (!Worklist.empty())
+    for (const CFGBlock *Succ : Worklist.pop_back_val()->succs())
+      if (!Reachable.test(Succ->getBlockId())) {
+        Reachable.set(Succ->getBlockId());
+        Worklist.push_back(Succ);
+      }
+
+  // Loop variables are written by the loop, not by the program.
+  for (const CFGBlock *B : Cfg) {
+    if (!Reachable.test(B->getBlockId()))
+      continue;
+    for (const CFGDefUse::Access &A : DefUse.getAccesses(*B)) {
+      if (!A.isDef() || !Liveness.isDeadDef(A.Def) ||
+          !Locals.contains(DefUse.getVariable(A.Var)))
+        continue;
+      if (auto *F = dyn_cast_if_present<ForStmt>(B->getTerminator().getStmt());
+          F && F->getTarget() == A.Ref)
+        continue;
+      DeadStores.push_back(A.Ref);
+      DeadStoreSet.insert(A.Ref);
+    }
+  }
+}
+
+void VariableUsage::emitWarnings(DiagnosticsEngine &Diags) const {
+  for (const VarDef *V : Unused)
+    Diags.emitWarning(V->getNameId()->getLocation().Start,
+                      diag::warn_unused_variable)
+        << V->getName();
+  for (const DeclRef *D : DeadStores)
+    Diags.emitWarning(D->getLocation().Start, diag::warn_dead_store)
+        << D->getName();
+}
+
+void VariableUsage::dump(raw_ostream &OS) const {
+  for (const VarDef *V : Unused)
+    OS << "  unused: " << V->getName() << "\n";
+  for (const DeclRef *D : DeadStores)
+    OS << "  dead store: " << D->getName() << "\n";
+}
+} // namespace chocopy
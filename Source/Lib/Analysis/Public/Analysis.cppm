@@ -1,2 +1,12 @@
 export module Analysis;
 export import :CFG;
+export import :CFGCache;
+export import :CallGraph;
+export import :ConstantPropagation;
+export import :Dataflow;
+export import :Dominators;
+export import :EscapeAnalysis;
+export import :LiveVariables;
+export import :ProgramAnalysis;
+export import :ReachingDefinitions;
+export import :VariableUsage;
@@ -63,9 +63,15 @@ private:
   llvm::PointerIntPair<void *, 1> Ptr;
 };
 
+/// A basic block. Its elements and edges live in arrays owned by the
+/// allocator of its CFG, so a block has nothing to destroy. Elements are
+/// stored in reverse order, as the CFG is built backwards.
 class CFGBlock {
+  friend class CFG;
+
 private:
-  using ElementList = SmallVector<CFGElement>;
+  using ElementIterator = CFGElement *;
+  using ConstElementIterator = const CFGElement *;
 
   template <bool IsConst> class ElementRefImpl {
     template <bool IsOtherConst> friend class ElementRefImpl;
@@ -116,10 +122,11 @@ private:
 
     using UnderlayingIteratorTy = std::conditional_t<
         IsConst,
-        std::conditional_t<IsReverse, ElementList::const_reverse_iterator,
-                           ElementList::const_iterator>,
-        std::conditional_t<IsReverse, ElementList::reverse_iterator,
-                           ElementList::iterator>>;
+        std::conditional_t<IsReverse,
+                           std::reverse_iterator<ConstElementIterator>,
+                           ConstElementIterator>,
+        std::conditional_t<IsReverse, std::reverse_iterator<ElementIterator>,
+                           ElementIterator>>;
 
     using IteratorTraits = typename std::iterator_traits<UnderlayingIteratorTy>;
     using ElementRef = typename CFGBlock::ElementRefImpl<IsConst>;
@@ -199,29 +206,29 @@ private:
   };
 
 public:
-  CFGBlock(unsigned BlockId) : BlockId(BlockId) {}
+  CFGBlock(CFG *Parent, unsigned BlockId) : Parent(Parent), BlockId(BlockId) {}
 
 public:
   // Statement iterators
-  using iterator = ElementList::reverse_iterator;
-  using const_iterator = ElementList::const_reverse_iterator;
-  using reverse_iterator = ElementList::iterator;
-  using const_reverse_iterator = ElementList::const_iterator;
+  using iterator = std::reverse_iterator<ElementIterator>;
+  using const_iterator = std::reverse_iterator<ConstElementIterator>;
+  using reverse_iterator = ElementIterator;
+  using const_reverse_iterator = ConstElementIterator;
 
   std::size_t getIndexInCFG() const;
 
-  CFGElement front() const { return Elements.back(); }
-  CFGElement back() const { return Elements.front(); }
+  CFGElement front() const { return Elements[NumElements - 1]; }
+  CFGElement back() const { return Elements[0]; }
 
-  iterator begin() { return Elements.rbegin(); }
-  iterator end() { return Elements.rend(); }
-  const_iterator begin() const { return Elements.rbegin(); }
-  const_iterator end() const { return Elements.rend(); }
+  iterator begin() { return iterator(rend()); }
+  iterator end() { return iterator(rbegin()); }
+  const_iterator begin() const { return const_iterator(rend()); }
+  const_iterator end() const { return const_iterator(rbegin()); }
 
-  reverse_iterator rbegin() { return Elements.begin(); }
-  reverse_iterator rend() { return Elements.end(); }
-  const_reverse_iterator rbegin() const { return Elements.begin(); }
-  const_reverse_iterator rend() const { return Elements.end(); }
+  reverse_iterator rbegin() { return Elements; }
+  reverse_iterator rend() { return Elements + NumElements; }
+  const_reverse_iterator rbegin() const { return Elements; }
+  const_reverse_iterator rend() const { return Elements + NumElements; }
 
   using CFGElementRef = ElementRefImpl<false>;
   using ConstCFGElementRef = ElementRefImpl<true>;
@@ -255,36 +262,45 @@ public:
     return {rref_begin(), rref_end()};
   }
 
-  unsigned size() const { return Elements.size(); }
-  bool empty() const { return Elements.empty(); }
+  unsigned size() const { return NumElements; }
+  bool empty() const { return NumElements == 0; }
 
   CFGElement operator[](std::size_t i) const { return Elements[i]; }
 
   // CFG iterators
-  using AdjacentBlocks = SmallVector<CFGBlock *>;
-  using pred_iterator = AdjacentBlocks::iterator;
-  using const_pred_iterator = AdjacentBlocks::const_iterator;
-  using pred_reverse_iterator = AdjacentBlocks::reverse_iterator;
-  using const_pred_reverse_iterator = AdjacentBlocks::const_reverse_iterator;
+  using pred_iterator = CFGBlock **;
+  using const_pred_iterator = CFGBlock *const *;
+  using pred_reverse_iterator = std::reverse_iterator<pred_iterator>;
+  using const_pred_reverse_iterator =
+      std::reverse_iterator<const_pred_iterator>;
   using pred_range = llvm::iterator_range<pred_iterator>;
   using pred_const_range = llvm::iterator_range<const_pred_iterator>;
 
-  using succ_iterator = AdjacentBlocks::iterator;
-  using const_succ_iterator = AdjacentBlocks::const_iterator;
-  using succ_reverse_iterator = AdjacentBlocks::reverse_iterator;
-  using const_succ_reverse_iterator = AdjacentBlocks::const_reverse_iterator;
+  using succ_iterator = CFGBlock **;
+  using const_succ_iterator = CFGBlock *const *;
+  using succ_reverse_iterator = std::reverse_iterator<succ_iterator>;
+  using const_succ_reverse_iterator =
+      std::reverse_iterator<const_succ_iterator>;
   using succ_range = llvm::iterator_range<succ_iterator>;
   using succ_const_range = llvm::iterator_range<const_succ_iterator>;
 
-  pred_iterator pred_begin() { return Preds.begin(); }
-  pred_iterator pred_end() { return Preds.end(); }
-  const_pred_iterator pred_begin() const { return Preds.begin(); }
-  const_pred_iterator pred_end() const { return Preds.end(); }
+  pred_iterator pred_begin() { return Preds; }
+  pred_iterator pred_end() { return Preds + NumPreds; }
+  const_pred_iterator pred_begin() const { return Preds; }
+  const_pred_iterator pred_end() const { return Preds + NumPreds; }
 
-  pred_reverse_iterator pred_rbegin() { return Preds.rbegin(); }
-  pred_reverse_iterator pred_rend() { return Preds.rend(); }
-  const_pred_reverse_iterator pred_rbegin() const { return Preds.rbegin(); }
-  const_pred_reverse_iterator pred_rend() const { return Preds.rend(); }
+  pred_reverse_iterator pred_rbegin() {
+    return pred_reverse_iterator(pred_end());
+  }
+  pred_reverse_iterator pred_rend() {
+    return pred_reverse_iterator(pred_begin());
+  }
+  const_pred_reverse_iterator pred_rbegin() const {
+    return const_pred_reverse_iterator(pred_end());
+  }
+  const_pred_reverse_iterator pred_rend() const {
+    return const_pred_reverse_iterator(pred_begin());
+  }
 
   pred_range preds() { return pred_range(pred_begin(), pred_end()); }
 
@@ -292,15 +308,23 @@ public:
     return pred_const_range(pred_begin(), pred_end());
   }
 
-  succ_iterator succ_begin() { return Succs.begin(); }
-  succ_iterator succ_end() { return Succs.end(); }
-  const_succ_iterator succ_begin() const { return Succs.begin(); }
-  const_succ_iterator succ_end() const { return Succs.end(); }
+  succ_iterator succ_begin() { return Succs; }
+  succ_iterator succ_end() { return Succs + NumSuccs; }
+  const_succ_iterator succ_begin() const { return Succs; }
+  const_succ_iterator succ_end() const { return Succs + NumSuccs; }
 
-  succ_reverse_iterator succ_rbegin() { return Succs.rbegin(); }
-  succ_reverse_iterator succ_rend() { return Succs.rend(); }
-  const_succ_reverse_iterator succ_rbegin() const { return Succs.rbegin(); }
-  const_succ_reverse_iterator succ_rend() const { return Succs.rend(); }
+  succ_reverse_iterator succ_rbegin() {
+    return succ_reverse_iterator(succ_end());
+  }
+  succ_reverse_iterator succ_rend() {
+    return succ_reverse_iterator(succ_begin());
+  }
+  const_succ_reverse_iterator succ_rbegin() const {
+    return const_succ_reverse_iterator(succ_end());
+  }
+  const_succ_reverse_iterator succ_rend() const {
+    return const_succ_reverse_iterator(succ_begin());
+  }
 
   succ_range succs() { return succ_range(succ_begin(), succ_end()); }
 
@@ -308,20 +332,17 @@ public:
     return succ_const_range(succ_begin(), succ_end());
   }
 
-  unsigned succ_size() const { return Succs.size(); }
-  bool succ_empty() const { return Succs.empty(); }
-
-  unsigned pred_size() const { return Preds.size(); }
-  bool pred_empty() const { return Preds.empty(); }
-
-  void addSuccessor(CFGBlock *B) {
-    Succs.push_back(B);
-    B->Preds.push_back(this);
-  }
+  unsigned succ_size() const { return NumSuccs; }
+  bool succ_empty() const { return NumSuccs == 0; }
 
-  void appendStmt(Stmt *S) { Elements.push_back(CFGElement(this, S)); }
+  unsigned pred_size() const { return NumPreds; }
+  bool pred_empty() const { return NumPreds == 0; }
 
-  void appendExpr(Expr *E) { Elements.push_back(CFGElement(this, E)); }
+  // Only valid while the CFG is built, the blocks are laid out when it is
+  // finalized.
+  void addSuccessor(CFGBlock *B);
+  void appendStmt(Stmt *S);
+  void appendExpr(Expr *E);
 
   void setTerminator(CFGTerminator T) { Terminator = T; }
   CFGTerminator getTerminator() const { return Terminator; }
@@ -330,51 +351,78 @@ public:
 
   unsigned getBlockId() const { return BlockId; }
 
+  void print(raw_ostream &OS) const;
+  void printAsOperand(raw_ostream &OS, bool PrintType = true) const {
+    OS << "BB" << BlockId;
+  }
+
+  /// Required by llvm::LoopBase. Code can always be moved into a block, it
+  /// has no instructions.
+  bool isLegalToHoistInto() const { return true; }
+
 private:
   CFG *Parent;
-  ElementList Elements;
+  CFGElement *Elements = nullptr;
+  CFGBlock **Preds = nullptr;
+  CFGBlock **Succs = nullptr;
   CFGTerminator Terminator;
   unsigned BlockId;
-  AdjacentBlocks Preds;
-  AdjacentBlocks Succs;
+  unsigned NumElements = 0;
+  unsigned NumPreds = 0;
+  unsigned NumSuccs = 0;
 };
 
 class CFG {
 public:
+  /// Builds the CFG of \p Stmts, the body of \p F or the top-level
+  /// statements of the program if \p F is null.
+  static std::unique_ptr<CFG> buildCFG(ArrayRef<Stmt *> Stmts, FuncDef *F);
   static std::unique_ptr<CFG> buildCFG(FuncDef *FD);
+  static std::unique_ptr<CFG> buildCFG(Program *P);
 
 public:
+  CFG();
+  ~CFG();
+
   CFGBlock *createBlock();
 
-  using CFGBlockListTy = SmallVector<CFGBlock *>;
-  using iterator = CFGBlockListTy::iterator;
-  using const_iterator = CFGBlockListTy::const_iterator;
+  /// Lays out the elements and edges of the blocks in the allocator, grouped
+  /// by block. Blocks can not be created or changed anymore, and only now can
+  /// the CFG be iterated.
+  void finalize();
+
+  using iterator = CFGBlock **;
+  using const_iterator = CFGBlock *const *;
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-  CFGBlock &front() { return *Blocks.front(); }
-  CFGBlock &back() { return *Blocks.back(); }
+  CFGBlock &front() { return *Blocks[0]; }
+  CFGBlock &back() { return *Blocks[NumBlocks - 1]; }
 
-  iterator begin() { return Blocks.begin(); }
-  iterator end() { return Blocks.end(); }
-  const_iterator begin() const { return Blocks.begin(); }
-  const_iterator end() const { return Blocks.end(); }
+  iterator begin() { return Blocks; }
+  iterator end() { return Blocks + NumBlocks; }
+  const_iterator begin() const { return Blocks; }
+  const_iterator end() const { return Blocks + NumBlocks; }
 
-  iterator nodes_begin() { return iterator(Blocks.begin()); }
-  iterator nodes_end() { return iterator(Blocks.end()); }
+  iterator nodes_begin() { return begin(); }
+  iterator nodes_end() { return end(); }
 
   llvm::iterator_range<iterator> nodes() { return {begin(), end()}; }
   llvm::iterator_range<const_iterator> const_nodes() const {
     return {begin(), end()};
   }
 
-  const_iterator nodes_begin() const { return const_iterator(Blocks.begin()); }
-  const_iterator nodes_end() const { return const_iterator(Blocks.end()); }
+  const_iterator nodes_begin() const { return begin(); }
+  const_iterator nodes_end() const { return end(); }
 
-  reverse_iterator rbegin() { return Blocks.rbegin(); }
-  reverse_iterator rend() { return Blocks.rend(); }
-  const_reverse_iterator rbegin() const { return Blocks.rbegin(); }
-  const_reverse_iterator rend() const { return Blocks.rend(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
 
   llvm::iterator_range<reverse_iterator> reverse_nodes() {
     return {rbegin(), rend()};
@@ -390,17 +438,47 @@ public:
 
   void setEntry(CFGBlock *B) { Entry = B; }
 
-  void dump();
+  /// The function or method whose body this is, null for the top-level
+  /// statements.
+  FuncDef *getFunction() const { return Function; }
+  bool isTopLevel() const { return !Function; }
+  void setFunction(FuncDef *F) { Function = F; }
+
+  /// The declarations of the function or of the program. The initializers of
+  /// its variables hold on entry.
+  ArrayRef<Declaration *> getDeclarations() const { return Declarations; }
+  void setDeclarations(ArrayRef<Declaration *> D) { Declarations = D; }
+
+  /// The variables and parameters of the function, or the globals of the
+  /// top-level statements, that no nested function or class refers to or
+  /// declares global or nonlocal. Only the CFG reads and writes them.
+  llvm::DenseSet<const SymbolInfo *> collectLocalNames() const;
+
+  /// The statements the CFG was built from.
+  ArrayRef<Stmt *> getBody() const { return Body; }
+  void setBody(ArrayRef<Stmt *> S) { Body = S; }
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
 
 public:
-  unsigned size() const { return Blocks.size(); }
+  unsigned size() const { return NumBlocks; }
 
 private:
+  friend class CFGBlock;
+  struct BuildState;
+
   unsigned NumBlockIds = 0;
-  CFGBlockListTy Blocks;
+  CFGBlock **Blocks = nullptr;
+  unsigned NumBlocks = 0;
   CFGBlock *Entry;
   CFGBlock *Exit;
+  FuncDef *Function = nullptr;
+  ArrayRef<Declaration *> Declarations;
+  ArrayRef<Stmt *> Body;
   llvm::BumpPtrAllocator Allocator;
+  /// What the blocks are made of until the CFG is finalized.
+  std::unique_ptr<BuildState> Pending;
 };
 
 void dumpCFG(Program *);
@@ -0,0 +1,42 @@
+export module Analysis:CFGCache;
+
+import :CFG;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// The CFGs of a whole program, built on first use and kept for the analyses
+/// that follow. The top-level statements have a CFG, and so does every
+/// function, method and nested function.
+class CFGCache {
+public:
+  explicit CFGCache(Program *P);
+
+  Program *getProgram() const { return P; }
+
+  /// The functions and methods of the program, enclosing ones before nested
+  /// ones, otherwise in source order.
+  ArrayRef<FuncDef *> getFunctions() const { return Functions; }
+  /// The position of \p F in getFunctions().
+  unsigned getFunctionIndex(const FuncDef *F) const;
+
+  CFG &getTopLevelCFG();
+  /// CFGs of different functions may be requested concurrently.
+  CFG &getCFG(FuncDef *F);
+
+  /// Builds the CFGs that were not requested yet.
+  void buildAll();
+
+  /// Dumps the CFGs of the functions and then the top-level one.
+  void dump();
+
+private:
+  Program *P;
+  SmallVector<FuncDef *> Functions;
+  llvm::DenseMap<const FuncDef *, unsigned> FunctionIndex;
+  std::unique_ptr<CFG> TopLevel;
+  SmallVector<std::unique_ptr<CFG>> FunctionCFGs;
+};
+} // namespace chocopy
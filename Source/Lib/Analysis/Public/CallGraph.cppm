@@ -0,0 +1,115 @@
+export module Analysis:CallGraph;
+
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// A function or method of the program, or one of the two nodes that stand
+/// for the top-level statements and for the outside world.
+class CallGraphNode {
+public:
+  using iterator = CallGraphNode *const *;
+
+public:
+  /// The function, null for the top-level statements and the external node.
+  FuncDef *getFunction() const { return F; }
+  /// The class of a method, null otherwise.
+  ClassDef *getClass() const { return Class; }
+  unsigned getId() const { return Id; }
+
+  /// The functions this one may call, each once.
+  ArrayRef<CallGraphNode *> callees() const { return Callees; }
+  iterator begin() const { return Callees.begin(); }
+  iterator end() const { return Callees.end(); }
+
+  bool calls(const CallGraphNode *N) const;
+
+  void printName(raw_ostream &OS) const;
+
+private:
+  friend class CallGraph;
+
+  CallGraphNode(unsigned Id, FuncDef *F, ClassDef *Class)
+      : F(F), Class(Class), Id(Id) {}
+
+private:
+  FuncDef *F;
+  ClassDef *Class;
+  unsigned Id;
+  SmallVector<CallGraphNode *, 4> Callees;
+};
+
+/// Functions that call each other, directly or not.
+struct CallGraphSCC {
+  SmallVector<CallGraphNode *, 1> Nodes;
+  /// Whether a function of the SCC may call itself.
+  bool IsRecursive = false;
+};
+
+/// The functions of a program and the calls between them, built from the
+/// declarations Sema resolved. Calls of predefined functions are not edges.
+///
+/// A method call may dispatch to the method inherited by the static type of
+/// the receiver or to any override of it in a subclass. If the receiver is
+/// not of a class of the program, it may call any method of that name.
+class CallGraph {
+public:
+  explicit CallGraph(Program *P);
+
+  /// The node that calls the top-level statements and every function, so
+  /// that all nodes are reachable from it.
+  CallGraphNode *getExternalNode() const { return Nodes[0].get(); }
+  CallGraphNode *getTopLevelNode() const { return Nodes[1].get(); }
+  /// The node of \p F, null if \p F is not declared by the program.
+  CallGraphNode *getNode(const FuncDef *F) const {
+    return FunctionNodes.lookup(F);
+  }
+  unsigned size() const { return Nodes.size(); }
+
+  /// The SCCs of the graph without the external node, callees before their
+  /// callers. Functions of different SCCs that precede a given one can be
+  /// processed concurrently before it.
+  ArrayRef<CallGraphSCC> getSCCs() const { return SCCs; }
+  /// The position of the SCC of \p N in getSCCs().
+  unsigned getSCCIndex(const CallGraphNode *N) const {
+    return SCCIndex[N->getId()];
+  }
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+private:
+  CallGraphNode *createNode(FuncDef *F, ClassDef *Class);
+  void addCall(CallGraphNode *Caller, CallGraphNode *Callee);
+  void computeSCCs();
+
+private:
+  class Builder;
+
+  SmallVector<std::unique_ptr<CallGraphNode>, 0> Nodes;
+  llvm::DenseMap<const FuncDef *, CallGraphNode *> FunctionNodes;
+  SmallVector<CallGraphSCC, 0> SCCs;
+  SmallVector<unsigned, 0> SCCIndex;
+};
+} // namespace chocopy
+
+namespace llvm {
+template <> struct GraphTraits<::chocopy::CallGraphNode *> {
+  using NodeRef = ::chocopy::CallGraphNode *;
+  using ChildIteratorType = ::chocopy::CallGraphNode::iterator;
+
+  static NodeRef getEntryNode(NodeRef N) { return N; }
+  static ChildIteratorType child_begin(NodeRef N) { return N->begin(); }
+  static ChildIteratorType child_end(NodeRef N) { return N->end(); }
+};
+
+template <>
+struct GraphTraits<const ::chocopy::CallGraph *>
+    : GraphTraits<::chocopy::CallGraphNode *> {
+  static NodeRef getEntryNode(const ::chocopy::CallGraph *G) {
+    return G->getExternalNode();
+  }
+};
+} // namespace llvm
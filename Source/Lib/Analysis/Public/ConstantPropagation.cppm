@@ -0,0 +1,160 @@
+export module Analysis:ConstantPropagation;
+
+import :CFG;
+import :Dataflow;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// A value of the constant propagation lattice. Undefined is above every
+/// constant and means the value was never computed, Overdefined is below
+/// them all and means it is not known at compile time.
+class ConstantValue {
+public:
+  enum class Kind : std::uint8_t {
+    Undefined,
+    Int,
+    Bool,
+    Str,
+    None,
+    Overdefined
+  };
+
+public:
+  ConstantValue() = default;
+
+  static ConstantValue getInt(std::int32_t V) {
+    ConstantValue C(Kind::Int);
+    C.IntVal = V;
+    return C;
+  }
+
+  static ConstantValue getBool(bool V) {
+    ConstantValue C(Kind::Bool);
+    C.BoolVal = V;
+    return C;
+  }
+
+  /// \p V must outlive the value.
+  static ConstantValue getStr(StringRef V) {
+    ConstantValue C(Kind::Str);
+    C.StrVal = V;
+    return C;
+  }
+
+  static ConstantValue getNone() { return ConstantValue(Kind::None); }
+  static ConstantValue getOverdefined() {
+    return ConstantValue(Kind::Overdefined);
+  }
+
+  Kind getKind() const { return K; }
+  bool isUndefined() const { return K == Kind::Undefined; }
+  bool isOverdefined() const { return K == Kind::Overdefined; }
+  bool isConstant() const { return !isUndefined() && !isOverdefined(); }
+
+  bool isInt() const { return K == Kind::Int; }
+  bool isBool() const { return K == Kind::Bool; }
+  bool isStr() const { return K == Kind::Str; }
+  bool isNone() const { return K == Kind::None; }
+
+  std::int32_t getIntValue() const { return IntVal; }
+  bool getBoolValue() const { return BoolVal; }
+  StringRef getStrValue() const { return StrVal; }
+
+  /// The greatest value below both \p A and \p B.
+  static ConstantValue meet(const ConstantValue &A, const ConstantValue &B);
+
+  bool operator==(const ConstantValue &Other) const;
+  bool operator!=(const ConstantValue &Other) const {
+    return !(*this == Other);
+  }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  explicit ConstantValue(Kind K) : K(K) {}
+
+private:
+  Kind K = Kind::Undefined;
+  bool BoolVal = false;
+  std::int32_t IntVal = 0;
+  StringRef StrVal;
+};
+
+/// Sparse conditional constant propagation over a CFG. Integer, boolean and
+/// string constants flow from literals and the initializers of the local
+/// variables through assignments and operators. Branches on constant
+/// conditions only make their taken successor reachable.
+///
+/// Parameters, globals and nonlocals are not constant in a function. A call
+/// may write any name that some function declares global or nonlocal, and
+/// every name that is not local.
+class ConstantPropagation {
+public:
+  /// \p CallClobbered holds the names declared global or nonlocal anywhere
+  /// in the program.
+  ConstantPropagation(
+      const CFG &Cfg,
+      const llvm::DenseSet<const SymbolInfo *> &CallClobbered);
+
+  /// Collects the names declared global or nonlocal in \p P.
+  static llvm::DenseSet<const SymbolInfo *>
+  collectCallClobberedNames(Program *P);
+
+  const CFGDefUse &getDefUse() const { return DefUse; }
+
+  bool isReachable(const CFGBlock &B) const {
+    return Reachable.test(B.getBlockId());
+  }
+
+  bool isEdgeExecutable(const CFGBlock &From, const CFGBlock &To) const {
+    return ExecutableEdges.contains({From.getBlockId(), To.getBlockId()});
+  }
+
+  /// The value of \p E every time it is evaluated. It is Undefined if \p E
+  /// is never evaluated or is the target of an assignment. A constant \p E
+  /// evaluates nothing with side effects, so it can be folded whole.
+  ConstantValue getValue(const Expr *E) const {
+    return ExprValues.lookup(E);
+  }
+
+  /// Whether \p E may be evaluated.
+  bool isExecuted(const Expr *E) const { return !getValue(E).isUndefined(); }
+
+  /// Whether \p S may be executed. Only statements of the CFG are known.
+  bool isExecuted(const Stmt *S) const;
+
+  void dump(raw_ostream &OS) const;
+
+private:
+  using State = SmallVector<ConstantValue, 0>;
+
+  void solve();
+  /// Evaluates \p B from the state at its entry and returns whether its exit
+  /// state or the value of one of its expressions changed.
+  bool visitBlock(const CFGBlock &B);
+  ConstantValue evaluate(const Expr *E, const State &S);
+  ConstantValue evaluateBinary(const BinaryExpr *B);
+  StringRef saveString(StringRef Str);
+
+private:
+  const CFG &Cfg;
+  CFGDefUse DefUse;
+  /// State on entry of the CFG, from the initializers of local variables.
+  State EntryState;
+  /// Names that calls may write.
+  llvm::BitVector ClobberedVars;
+  /// Assignment and for loop targets, which are written and not evaluated.
+  llvm::DenseSet<const Expr *> Targets;
+  llvm::DenseMap<const Stmt *, const CFGBlock *> StmtBlocks;
+  llvm::BitVector Reachable;
+  llvm::DenseSet<std::pair<unsigned, unsigned>> ExecutableEdges;
+  /// State on exit of each block.
+  SmallVector<State, 0> ExitStates;
+  llvm::DenseMap<const Expr *, ConstantValue> ExprValues;
+  /// Strings built by folding.
+  llvm::BumpPtrAllocator Strings;
+};
+} // namespace chocopy
@@ -0,0 +1,143 @@
+export module Analysis:Dataflow;
+
+import :CFG;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// The reads and writes of names in a CFG, in execution order for each
+/// block. Names and writes are numbered densely, so sets of them can be kept
+/// in bit vectors. A write is called a definition.
+///
+/// The targets of assignments and the target of a for loop are writes, every
+/// other DeclRef is a read, except references to functions and classes.
+/// Parameters and the variables the CFG declares are also written on entry,
+/// by the caller or by their initializer. These definitions come after those
+/// of the blocks and belong to no block.
+class CFGDefUse {
+public:
+  static constexpr unsigned NoDef = ~0u;
+
+  struct Access {
+    /// Index of the name.
+    unsigned Var;
+    /// Index of the definition for a write, NoDef for a read.
+    unsigned Def;
+    /// Null for a definition on entry.
+    const DeclRef *Ref;
+
+    bool isDef() const { return Def != NoDef; }
+  };
+
+public:
+  explicit CFGDefUse(const CFG &Cfg);
+
+  unsigned getNumVariables() const { return Variables.size(); }
+  unsigned getNumDefs() const { return Defs.size(); }
+
+  const SymbolInfo *getVariable(unsigned Var) const { return Variables[Var]; }
+  std::optional<unsigned> getVariableIndex(const SymbolInfo *SI) const;
+
+  const Access &getDef(unsigned Def) const { return Accesses[Defs[Def]]; }
+  /// Definitions of \p Var, the one on entry first and then in block order.
+  ArrayRef<unsigned> getDefsOf(unsigned Var) const { return VarDefs[Var]; }
+
+  bool isEntryDef(unsigned Def) const { return Def >= FirstEntryDef; }
+  unsigned getFirstEntryDef() const { return FirstEntryDef; }
+
+  ArrayRef<Access> getAccesses(const CFGBlock &B) const {
+    unsigned Id = B.getBlockId();
+    return ArrayRef<Access>(Accesses).slice(
+        BlockStart[Id], BlockStart[Id + 1] - BlockStart[Id]);
+  }
+
+private:
+  void addAccess(const DeclRef *Ref, bool IsDef);
+  void addEntryDef(const Declaration *D);
+
+private:
+  /// Accesses of all blocks, by block ID.
+  SmallVector<Access, 0> Accesses;
+  SmallVector<unsigned, 0> BlockStart;
+  SmallVector<const SymbolInfo *, 0> Variables;
+  llvm::DenseMap<const SymbolInfo *, unsigned> VarIndex;
+  /// Index in Accesses of each definition.
+  SmallVector<unsigned, 0> Defs;
+  unsigned FirstEntryDef = 0;
+  SmallVector<SmallVector<unsigned, 2>, 0> VarDefs;
+};
+
+/// Solves a dataflow problem whose facts are bit vectors over the blocks of
+/// a CFG. A block is described by its Gen and Kill sets and transfers
+///
+///   Out = Gen | (In & ~Kill)
+///
+/// where In is the meet of the Out of the predecessors for a forward problem,
+/// or of the successors for a backward one.
+///
+/// Blocks are taken from a worklist ordered by reverse postorder, postorder
+/// for backward problems, so an acyclic CFG is solved in one pass over its
+/// blocks. Blocks unreachable from the entry keep their initial value.
+class BitVectorDataflow {
+public:
+  enum class Direction { Forward, Backward };
+  enum class MeetOp { Union, Intersection };
+
+public:
+  BitVectorDataflow(const CFG &Cfg, unsigned NumBits, Direction Dir,
+                    MeetOp Meet);
+
+  unsigned getNumBits() const { return NumBits; }
+
+  llvm::BitVector &getGen(const CFGBlock &B) {
+    return Blocks[B.getBlockId()].Gen;
+  }
+
+  llvm::BitVector &getKill(const CFGBlock &B) {
+    return Blocks[B.getBlockId()].Kill;
+  }
+
+  /// Sets the value flowing into the entry block, or out of the exit block
+  /// for a backward problem. It is empty by default.
+  void setBoundary(llvm::BitVector V) { Boundary = std::move(V); }
+
+  /// Computes the fixed point and returns the number of block transfers it
+  /// took.
+  unsigned solve();
+
+  /// Value at the start of \p B, in execution order.
+  const llvm::BitVector &getEntryValue(const CFGBlock &B) const {
+    const BlockState &S = Blocks[B.getBlockId()];
+    return Dir == Direction::Forward ? S.In : S.Out;
+  }
+
+  /// Value at the end of \p B, in execution order.
+  const llvm::BitVector &getExitValue(const CFGBlock &B) const {
+    const BlockState &S = Blocks[B.getBlockId()];
+    return Dir == Direction::Forward ? S.Out : S.In;
+  }
+
+private:
+  struct BlockState {
+    llvm::BitVector Gen;
+    llvm::BitVector Kill;
+    llvm::BitVector In;
+    llvm::BitVector Out;
+  };
+
+  /// Returns the blocks reachable from the entry in the order they are
+  /// first visited by the solver.
+  SmallVector<const CFGBlock *, 0> computeOrder() const;
+  void computeIn(const CFGBlock &B, llvm::BitVector &In) const;
+
+private:
+  const CFG &Cfg;
+  unsigned NumBits;
+  Direction Dir;
+  MeetOp Meet;
+  llvm::BitVector Boundary;
+  SmallVector<BlockState, 0> Blocks;
+};
+} // namespace chocopy
@@ -0,0 +1,102 @@
+export module Analysis:Dominators;
+
+import :CFG;
+import AST;
+import Basic;
+import std;
+
+namespace llvm {
+// The entry of a CFG is not its first block, the exit is.
+template <> struct DomTreeNodeTraits<::chocopy::CFGBlock> {
+  using NodeType = ::chocopy::CFGBlock;
+  using NodePtr = ::chocopy::CFGBlock *;
+  using ParentPtr = ::chocopy::CFG *;
+
+  static NodePtr getEntryNode(ParentPtr Parent) { return &Parent->getEntry(); }
+  static ParentPtr getParent(NodePtr BB) { return BB->getParent(); }
+};
+
+template <> struct GraphTraits<DomTreeNodeBase<::chocopy::CFGBlock> *> {
+  using NodeRef = DomTreeNodeBase<::chocopy::CFGBlock> *;
+  using ChildIteratorType = DomTreeNodeBase<::chocopy::CFGBlock>::iterator;
+
+  static NodeRef getEntryNode(NodeRef N) { return N; }
+  static ChildIteratorType child_begin(NodeRef N) { return N->begin(); }
+  static ChildIteratorType child_end(NodeRef N) { return N->end(); }
+};
+
+template <> struct GraphTraits<const DomTreeNodeBase<::chocopy::CFGBlock> *> {
+  using NodeRef = const DomTreeNodeBase<::chocopy::CFGBlock> *;
+  using ChildIteratorType =
+      DomTreeNodeBase<::chocopy::CFGBlock>::const_iterator;
+
+  static NodeRef getEntryNode(NodeRef N) { return N; }
+  static ChildIteratorType child_begin(NodeRef N) { return N->begin(); }
+  static ChildIteratorType child_end(NodeRef N) { return N->end(); }
+};
+} // namespace llvm
+
+export namespace chocopy {
+using CFGDomTree = llvm::DominatorTreeBase<CFGBlock, false>;
+using CFGPostDomTree = llvm::DominatorTreeBase<CFGBlock, true>;
+using CFGDomTreeNode = llvm::DomTreeNodeBase<CFGBlock>;
+
+/// A natural loop of a CFG. Its header is the block holding the condition of
+/// a while loop or the iterable of a for loop.
+class CFGLoop : public llvm::LoopBase<CFGBlock, CFGLoop> {
+public:
+  /// The while or for statement of the loop, null if the loop was not built
+  /// from one.
+  Stmt *getLoopStmt() const;
+
+private:
+  friend class llvm::LoopBase<CFGBlock, CFGLoop>;
+  friend class llvm::LoopInfoBase<CFGBlock, CFGLoop>;
+
+  CFGLoop() = default;
+  explicit CFGLoop(CFGBlock *Header)
+      : llvm::LoopBase<CFGBlock, CFGLoop>(Header) {}
+};
+
+/// The loop forest of a CFG.
+class CFGLoopInfo : public llvm::LoopInfoBase<CFGBlock, CFGLoop> {
+public:
+  CFGLoopInfo() = default;
+  explicit CFGLoopInfo(const CFGDomTree &DT) { analyze(DT); }
+};
+
+/// The dominator tree and loops of a CFG, computed together since loops are
+/// discovered from the dominator tree, and its post-dominator tree.
+class CFGLoopAnalysis {
+public:
+  explicit CFGLoopAnalysis(CFG &Cfg);
+
+  CFG &getCFG() const { return Cfg; }
+  const CFGDomTree &getDomTree() const { return DT; }
+  const CFGPostDomTree &getPostDomTree() const { return PDT; }
+  const CFGLoopInfo &getLoopInfo() const { return LI; }
+
+  /// The block every path from \p B to the exit goes through first, or null
+  /// for the exit and for blocks that never reach it.
+  CFGBlock *getImmediatePostDominator(const CFGBlock &B) const;
+
+  /// The number of loops containing \p B, 0 outside of any loop.
+  unsigned getLoopDepth(const CFGBlock &B) const { return LI.getLoopDepth(&B); }
+
+  /// The innermost loop containing \p B, or null.
+  CFGLoop *getLoopFor(const CFGBlock &B) const { return LI.getLoopFor(&B); }
+
+  /// Prints the immediate post-dominator of each block.
+  void dumpPostDomTree(raw_ostream &OS) const;
+
+private:
+  CFG &Cfg;
+  CFGDomTree DT;
+  CFGPostDomTree PDT;
+  CFGLoopInfo LI;
+};
+} // namespace chocopy
+
+extern template class llvm::LoopBase<::chocopy::CFGBlock, ::chocopy::CFGLoop>;
+extern template class llvm::LoopInfoBase<::chocopy::CFGBlock,
+                                         ::chocopy::CFGLoop>;
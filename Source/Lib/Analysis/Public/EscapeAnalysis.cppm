@@ -0,0 +1,71 @@
+export module Analysis:EscapeAnalysis;
+
+import :CFG;
+import :Dataflow;
+import :Dominators;
+import :LiveVariables;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// Finds the objects that may outlive the function that creates them.
+///
+/// Every expression evaluated by the CFG flows either nowhere, into a local
+/// variable, or out of the function: into a global, an attribute, a list
+/// element, a return value, or a call that may keep it. Print and len keep
+/// nothing. The analysis is flow-insensitive: a local escapes if any value
+/// of it does, and so does whatever is assigned to it.
+///
+/// Locals are the variables and parameters of the CFG that no nested
+/// function or class refers to; the top-level statements have none that a
+/// function refers to.
+class EscapeAnalysis {
+public:
+  EscapeAnalysis(const CFG &Cfg, const ASTContext &Ctx,
+                 const CFGLoopAnalysis &Loops, const LiveVariables &Liveness);
+
+  /// Whether the value of \p E may be referenced once the function returns.
+  /// Expressions the CFG does not evaluate may escape.
+  bool mayEscape(const Expr *E) const;
+
+  /// Whether the object created by \p E can live in the frame of the
+  /// function, in a single slot reused by every evaluation. It must not
+  /// escape, and inside a loop no local holding it may be live at the start
+  /// of the next iteration.
+  bool canAllocateOnStack(const Expr *E) const;
+
+  /// The list displays, constructor calls and concatenations of the CFG, in
+  /// source order.
+  ArrayRef<const Expr *> getAllocationSites() const { return Sites; }
+
+  void dump(raw_ostream &OS) const;
+
+private:
+  /// Where a value goes, a local variable index otherwise.
+  static constexpr unsigned Discard = ~0u;
+  static constexpr unsigned Escape = ~1u;
+
+  void visitStmt(const Stmt *S);
+  void visitValue(const Expr *E, unsigned Target);
+  void solve();
+  bool isLocal(const SymbolInfo *SI) const;
+
+private:
+  const ASTContext &Ctx;
+  const CFGLoopAnalysis &Loops;
+  const LiveVariables &Liveness;
+  const CFGDefUse &DefUse;
+  llvm::DenseSet<const SymbolInfo *> Locals;
+  /// Where the value of each evaluated expression goes.
+  llvm::DenseMap<const Expr *, SmallVector<unsigned, 1>> Flows;
+  /// The locals each local is assigned to.
+  SmallVector<SmallVector<unsigned, 2>, 0> AssignedTo;
+  llvm::BitVector EscapingVars;
+  SmallVector<const Expr *, 0> Sites;
+  /// The block and position in it of each expression.
+  llvm::DenseMap<const Expr *, std::pair<const CFGBlock *, unsigned>>
+      Positions;
+};
+} // namespace chocopy
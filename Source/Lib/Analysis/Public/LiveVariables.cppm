@@ -0,0 +1,41 @@
+export module Analysis:LiveVariables;
+
+import :CFG;
+import :Dataflow;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// Names that may be read before they are written again, at the boundaries
+/// of the blocks of a CFG, and the writes whose value is never read.
+class LiveVariables {
+public:
+  explicit LiveVariables(const CFG &Cfg);
+
+  const CFGDefUse &getDefUse() const { return DefUse; }
+
+  const llvm::BitVector &getLiveAtEntry(const CFGBlock &B) const {
+    return Dataflow.getEntryValue(B);
+  }
+
+  const llvm::BitVector &getLiveAtExit(const CFGBlock &B) const {
+    return Dataflow.getExitValue(B);
+  }
+
+  bool isLiveAtEntry(const CFGBlock &B, const SymbolInfo *SI) const;
+  bool isLiveAtExit(const CFGBlock &B, const SymbolInfo *SI) const;
+
+  /// Whether the value written by definition \p Def is never read.
+  bool isDeadDef(unsigned Def) const { return DeadDefs.test(Def); }
+
+  void dump(raw_ostream &OS) const;
+
+private:
+  const CFG &Cfg;
+  CFGDefUse DefUse;
+  BitVectorDataflow Dataflow;
+  llvm::BitVector DeadDefs;
+};
+} // namespace chocopy
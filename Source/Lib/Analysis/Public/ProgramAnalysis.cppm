@@ -0,0 +1,90 @@
+export module Analysis:ProgramAnalysis;
+
+import :CFG;
+import :CFGCache;
+import :CallGraph;
+import :ConstantPropagation;
+import :Dominators;
+import :EscapeAnalysis;
+import :LiveVariables;
+import :ReachingDefinitions;
+import :VariableUsage;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// The analyses of a single CFG.
+class CFGAnalyses {
+public:
+  CFGAnalyses(CFG &Cfg, const ASTContext &Ctx,
+              const llvm::DenseSet<const SymbolInfo *> &CallClobbered)
+      : Cfg(Cfg), Loops(Cfg), Liveness(Cfg), ReachingDefs(Cfg),
+        Constants(Cfg, CallClobbered), Escapes(Cfg, Ctx, Loops, Liveness),
+        Usage(Cfg, Liveness) {}
+
+  CFG &getCFG() const { return Cfg; }
+  const CFGLoopAnalysis &getLoops() const { return Loops; }
+  const LiveVariables &getLiveness() const { return Liveness; }
+  const ReachingDefinitions &getReachingDefs() const { return ReachingDefs; }
+  const ConstantPropagation &getConstants() const { return Constants; }
+  const EscapeAnalysis &getEscapes() const { return Escapes; }
+  const VariableUsage &getUsage() const { return Usage; }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  CFG &Cfg;
+  CFGLoopAnalysis Loops;
+  LiveVariables Liveness;
+  ReachingDefinitions ReachingDefs;
+  ConstantPropagation Constants;
+  EscapeAnalysis Escapes;
+  VariableUsage Usage;
+};
+
+/// Builds the CFGs of a program and runs the analyses over each of them.
+/// Functions share nothing but the AST, which is not modified, so they are
+/// processed concurrently. Each CFG allocates its blocks from its own
+/// allocator.
+class ProgramAnalysis {
+public:
+  ProgramAnalysis(const ASTContext &Ctx, Program *P) : Ctx(Ctx), Cache(P) {}
+
+  /// The number of threads to use, 0 for all cores.
+  void setNumThreads(unsigned N) { NumThreads = N; }
+  unsigned getNumThreads() const { return NumThreads; }
+
+  CFGCache &getCFGCache() { return Cache; }
+
+  void run();
+
+  const CFGAnalyses &getAnalyses(FuncDef *F) const;
+  const CFGAnalyses &getTopLevelAnalyses() const { return *Results.back(); }
+  /// The call graph of the program, built by run() once Sema resolved the
+  /// callees.
+  const CallGraph &getCallGraph() const { return *Calls; }
+
+  /// Warns about unused variables and dead stores, function by function in
+  /// source order and then in the top-level statements.
+  void emitWarnings(DiagnosticsEngine &Diags) const;
+
+  /// Prints the CFG and the analyses of every function in source order, then
+  /// those of the top-level statements, and then the call graph.
+  void print(raw_ostream &OS) const;
+
+private:
+  /// Calls \p Fn on every index below \p N, on NumThreads threads.
+  void parallelFor(std::size_t N,
+                   llvm::function_ref<void(std::size_t)> Fn) const;
+
+private:
+  const ASTContext &Ctx;
+  CFGCache Cache;
+  unsigned NumThreads = 0;
+  /// One entry per function, and the top-level statements last.
+  SmallVector<std::unique_ptr<CFGAnalyses>, 0> Results;
+  std::unique_ptr<CallGraph> Calls;
+};
+} // namespace chocopy
@@ -0,0 +1,40 @@
+export module Analysis:ReachingDefinitions;
+
+import :CFG;
+import :Dataflow;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// Writes of a CFG that may reach the boundaries of each block without being
+/// overwritten. Parameters and the variables the CFG declares are defined on
+/// entry, names declared outside the CFG have no definition in it.
+class ReachingDefinitions {
+public:
+  explicit ReachingDefinitions(const CFG &Cfg);
+
+  const CFGDefUse &getDefUse() const { return DefUse; }
+
+  const llvm::BitVector &getReachingAtEntry(const CFGBlock &B) const {
+    return Dataflow.getEntryValue(B);
+  }
+
+  const llvm::BitVector &getReachingAtExit(const CFGBlock &B) const {
+    return Dataflow.getExitValue(B);
+  }
+
+  /// Returns the definitions that may be read by the \p Idx-th access of
+  /// \p B.
+  SmallVector<unsigned, 4> getReachingDefs(const CFGBlock &B,
+                                           std::size_t Idx) const;
+
+  void dump(raw_ostream &OS) const;
+
+private:
+  const CFG &Cfg;
+  CFGDefUse DefUse;
+  BitVectorDataflow Dataflow;
+};
+} // namespace chocopy
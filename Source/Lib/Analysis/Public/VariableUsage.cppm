@@ -0,0 +1,42 @@
+export module Analysis:VariableUsage;
+
+import :CFG;
+import :Dataflow;
+import :LiveVariables;
+import AST;
+import Basic;
+import std;
+
+export namespace chocopy {
+
+/// Finds the local variables of a CFG that are declared but never used, and
+/// the assignments to locals whose value is never read. Only the names of
+/// CFG::collectLocalNames() qualify, any other may be read elsewhere.
+///
+/// ChocoPy requires an initializer for every variable, so no local can be
+/// read before it is assigned, and initializers are not reported as stores.
+class VariableUsage {
+public:
+  VariableUsage(const CFG &Cfg, const LiveVariables &Liveness);
+
+  /// Whether the value assigned to \p Target, an assignment target of the
+  /// CFG, is never read. The store can be dropped, the value is still
+  /// evaluated for its side effects.
+  bool isDeadStore(const DeclRef *Target) const {
+    return DeadStoreSet.contains(Target);
+  }
+
+  /// Dead stores in reachable blocks, in block order.
+  ArrayRef<const DeclRef *> getDeadStores() const { return DeadStores; }
+  /// Local variables neither read nor written, in declaration order.
+  ArrayRef<const VarDef *> getUnusedVariables() const { return Unused; }
+
+  void emitWarnings(DiagnosticsEngine &Diags) const;
+  void dump(raw_ostream &OS) const;
+
+private:
+  SmallVector<const DeclRef *, 0> DeadStores;
+  llvm::DenseSet<const DeclRef *> DeadStoreSet;
+  SmallVector<const VarDef *, 0> Unused;
+};
+} // namespace chocopy
@@ -13,15 +13,44 @@ const char *DiagnosticText[] = {
 const char *getDiagnosticText(unsigned DiagId) {
   return DiagnosticText[DiagId];
 }
+
+llvm::StringRef getLevelName(llvm::SourceMgr::DiagKind Kind) {
+  switch (Kind) {
+  case llvm::SourceMgr::DK_Error:
+    return "error";
+  case llvm::SourceMgr::DK_Warning:
+    return "warning";
+  case llvm::SourceMgr::DK_Remark:
+    return "remark";
+  case llvm::SourceMgr::DK_Note:
+    return "note";
+  }
+  return "note";
+}
 } // namespace
 
 namespace chocopy {
+bool DiagnosticsEngine::checkErrorLimit(SourceMgr::DiagKind Kind) {
+  if (ErrorLimitReached)
+    return false;
+  if (Kind != SourceMgr::DK_Error || !ErrorLimit || NumErrors < ErrorLimit)
+    return true;
+  ErrorLimitReached = true;
+  report(SourceMgr::DK_Error, SMLoc(),
+         getDiagnosticText(diag::err_too_many_errors));
+  return false;
+}
+
 InFlightDiagnostic DiagnosticsEngine::emitError(SMLoc Loc, unsigned DiagId) {
+  if (!checkErrorLimit(SourceMgr::DK_Error))
+    return InFlightDiagnostic();
   NumErrors++;
   return InFlightDiagnostic(this, SourceMgr::DK_Error, Loc, DiagId);
 }
 
 InFlightDiagnostic DiagnosticsEngine::emitWarning(SMLoc Loc, unsigned DiagId) {
+  if (!checkErrorLimit(SourceMgr::DK_Warning))
+    return InFlightDiagnostic();
   NumWarnings++;
   return InFlightDiagnostic(this, SourceMgr::DK_Warning, Loc, DiagId);
 }
@@ -32,54 +61,72 @@ void DiagnosticsEngine::report(SourceMgr::DiagKind Kind, SMLoc Loc,
   Client->handleDiagnostic(Diag);
 }
 
-void InFlightDiagnostic::emit() {
-  llvm::SmallString<100> Msg;
+void DiagnosticsEngine::forward(const Diagnostic &Diag) {
+  if (!checkErrorLimit(Diag.getKind()))
+    return;
+  if (Diag.getKind() == SourceMgr::DK_Error)
+    NumErrors++;
+  else if (Diag.getKind() == SourceMgr::DK_Warning)
+    NumWarnings++;
+  Client->handleDiagnostic(Diag);
+}
 
-  switch (Args.size()) {
-    break;
-  case 0:
-    Msg =
-        formatMessage(std::make_index_sequence<0>{}, getDiagnosticText(DiagId));
-    break;
-  case 1:
-    Msg =
-        formatMessage(std::make_index_sequence<1>{}, getDiagnosticText(DiagId));
-    break;
-  case 2:
-    Msg =
-        formatMessage(std::make_index_sequence<2>{}, getDiagnosticText(DiagId));
-    break;
-  case 3:
-    Msg =
-        formatMessage(std::make_index_sequence<3>{}, getDiagnosticText(DiagId));
-    break;
-  case 4:
-    Msg =
-        formatMessage(std::make_index_sequence<4>{}, getDiagnosticText(DiagId));
-    break;
-  case 5:
-    Msg =
-        formatMessage(std::make_index_sequence<5>{}, getDiagnosticText(DiagId));
-    break;
-  case 6:
-    Msg =
-        formatMessage(std::make_index_sequence<6>{}, getDiagnosticText(DiagId));
+void DiagnosticsEngine::uncount(ArrayRef<Diagnostic> Diags) {
+  for (const Diagnostic &Diag : Diags) {
+    if (Diag.getKind() == SourceMgr::DK_Error)
+      NumErrors--;
+    else if (Diag.getKind() == SourceMgr::DK_Warning)
+      NumWarnings--;
+  }
+}
+
+void DiagnosticArgument::print(raw_ostream &OS) const {
+  switch (Kind) {
+  case ArgKind::String:
+    OS << Str;
     break;
-  case 7:
-    Msg =
-        formatMessage(std::make_index_sequence<7>{}, getDiagnosticText(DiagId));
+  case ArgKind::SInt:
+    OS << SInt;
     break;
-  case 8:
-    Msg =
-        formatMessage(std::make_index_sequence<8>{}, getDiagnosticText(DiagId));
+  case ArgKind::Type:
+  case ArgKind::Token:
+    Object.Print(OS, Object.Ptr);
     break;
-  case 9:
-    Msg =
-        formatMessage(std::make_index_sequence<9>{}, getDiagnosticText(DiagId));
   }
+}
+
+void InFlightDiagnostic::emit() {
+  if (!DiagEngine)
+    return;
+
+  llvm::SmallString<100> Msg;
+  llvm::raw_svector_ostream OS(Msg);
+  formatMessage(OS, getDiagnosticText(DiagId));
   DiagEngine->report(Kind, Location, Msg);
 }
 
+void InFlightDiagnostic::formatMessage(raw_ostream &OS,
+                                       StringRef Format) const {
+  unsigned NextIdx = 0;
+  while (!Format.empty()) {
+    auto [Text, Rest] = Format.split('{');
+    OS << Text;
+    if (Text.size() == Format.size())
+      break;
+
+    auto [Spec, Tail] = Rest.split('}');
+    unsigned Idx = NextIdx;
+    if (!Spec.empty() && Spec.getAsInteger(10, Idx)) {
+      OS << '{' << Spec << '}';
+    } else {
+      if (Idx < Args.size())
+        Args[Idx].print(OS);
+      NextIdx = Idx + 1;
+    }
+    Format = Tail;
+  }
+}
+
 void TextDiagnosticPrinter::handleDiagnostic(const Diagnostic &Diag) {
   //   auto Num = SrcMgr.getNumBuffers();
   //   std::printf("%d\n", Num);
@@ -121,4 +168,108 @@ void TextDiagnosticPrinter::handleDiagnostic(const Diagnostic &Diag) {
 
 }
 
+void JSONDiagnosticPrinter::finish() {
+  SmallString<0> Buffer;
+  llvm::raw_svector_ostream BufferOS(Buffer);
+  {
+    llvm::json::OStream JOS(BufferOS, 2);
+    if (Format == OutputFormat::SARIF)
+      writeSARIF(JOS);
+    else
+      writeJSON(JOS);
+  }
+  BufferOS << '\n';
+  OS << Buffer;
+  OS.flush();
+  Diags.clear();
+}
+
+void JSONDiagnosticPrinter::writeJSON(llvm::json::OStream &JOS) {
+  JOS.object([&] {
+    JOS.attributeArray("diagnostics", [&] {
+      for (const Diagnostic &D : Diags) {
+        JOS.object([&] {
+          JOS.attribute("level", getLevelName(D.getKind()));
+          if (D.getLocation().isValid()) {
+            auto [Line, Column] = getLineAndColumn(D.getLocation());
+            JOS.attribute("file", getFileName(D.getLocation()));
+            JOS.attribute("line", Line);
+            JOS.attribute("column", Column);
+          }
+          JOS.attribute("message", D.getMessage());
+        });
+      }
+    });
+  });
+}
+
+void JSONDiagnosticPrinter::writeSARIF(llvm::json::OStream &JOS) {
+  JOS.object([&] {
+    JOS.attribute("$schema", "https://json.schemastore.org/sarif-2.1.0.json");
+    JOS.attribute("version", "2.1.0");
+    JOS.attributeArray("runs", [&] {
+      JOS.object([&] {
+        JOS.attributeObject("tool", [&] {
+          JOS.attributeObject("driver",
+                              [&] { JOS.attribute("name", "chocopy-llvm"); });
+        });
+        JOS.attributeArray("results", [&] {
+          for (const Diagnostic &D : Diags)
+            JOS.object([&] { writeSARIFResult(JOS, D); });
+        });
+      });
+    });
+  });
+}
+
+void JSONDiagnosticPrinter::writeSARIFResult(llvm::json::OStream &JOS,
+                                             const Diagnostic &D) {
+  // SARIF has no remark level.
+  JOS.attribute("level", D.getKind() == SourceMgr::DK_Remark
+                             ? StringRef("note")
+                             : getLevelName(D.getKind()));
+  JOS.attributeObject("message",
+                      [&] { JOS.attribute("text", D.getMessage()); });
+  if (!D.getLocation().isValid())
+    return;
+
+  auto [Line, Column] = getLineAndColumn(D.getLocation());
+  JOS.attributeArray("locations", [&] {
+    JOS.object([&] {
+      JOS.attributeObject("physicalLocation", [&] {
+        JOS.attributeObject("artifactLocation", [&] {
+          JOS.attribute("uri", getFileName(D.getLocation()));
+        });
+        JOS.attributeObject("region", [&] {
+          JOS.attribute("startLine", Line);
+          JOS.attribute("startColumn", Column);
+        });
+      });
+    });
+  });
+}
+
+auto JSONDiagnosticPrinter::getLineAndColumn(SMLoc Loc)
+    -> std::pair<unsigned, unsigned> {
+  unsigned BufferID = SrcMgr.FindBufferContainingLoc(Loc);
+  StringRef Text = SrcMgr.getMemoryBuffer(BufferID)->getBuffer();
+  SmallVector<unsigned, 0> &Offsets = LineOffsets[BufferID];
+  if (Offsets.empty()) {
+    Offsets.push_back(0);
+    for (std::size_t I = 0, E = Text.size(); I != E; ++I)
+      if (Text[I] == '\n')
+        Offsets.push_back(I + 1);
+  }
+
+  unsigned Offset = Loc.getPointer() - Text.data();
+  auto It = std::upper_bound(Offsets.begin(), Offsets.end(), Offset);
+  unsigned Line = It - Offsets.begin();
+  return {Line, Offset - *std::prev(It) + 1};
+}
+
+StringRef JSONDiagnosticPrinter::getFileName(SMLoc Loc) const {
+  unsigned BufferID = SrcMgr.FindBufferContainingLoc(Loc);
+  return SrcMgr.getMemoryBuffer(BufferID)->getBufferIdentifier();
+}
+
 } // namespace chocopy
@@ -3,6 +3,7 @@ import std;
 import LLVM;
 
 export namespace chocopy {
+using llvm::ArrayRef;
 using llvm::SmallVector;
 using llvm::SMLoc;
 using llvm::SourceMgr;
@@ -36,6 +37,38 @@ private:
   SourceMgr::DiagKind Kind;
 };
 
+/// An argument of an in-flight diagnostic. Arguments are kept unformatted
+/// and only printed when the diagnostic is emitted, so a dropped diagnostic
+/// costs no formatting. Types and tokens are defined above Basic, so they
+/// bring their own printer.
+class DiagnosticArgument {
+public:
+  enum class ArgKind { String, SInt, Type, Token };
+  using PrintFn = void (*)(raw_ostream &OS, const void *Obj);
+
+  DiagnosticArgument(StringRef S) : Kind(ArgKind::String), Str(S) {}
+  DiagnosticArgument(int V) : Kind(ArgKind::SInt), SInt(V) {}
+  DiagnosticArgument(ArgKind K, const void *Obj, PrintFn Print)
+      : Kind(K), Object{Obj, Print} {}
+
+  ArgKind getKind() const { return Kind; }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  struct ObjectArg {
+    const void *Ptr;
+    PrintFn Print;
+  };
+
+  ArgKind Kind;
+  union {
+    StringRef Str;
+    int SInt;
+    ObjectArg Object;
+  };
+};
+
 class DiagnosticConsumer {
 public:
   virtual ~DiagnosticConsumer() = default;
@@ -43,55 +76,130 @@ public:
   virtual void handleDiagnostic(const Diagnostic &Diag) = 0;
 };
 
+/// Keeps diagnostics instead of printing them, so that they can be replayed
+/// later in a different order or through another engine.
+class StoredDiagnosticConsumer final : public DiagnosticConsumer {
+public:
+  void handleDiagnostic(const Diagnostic &Diag) override {
+    Diags.push_back(Diag);
+  }
+
+  ArrayRef<Diagnostic> getDiagnostics() const { return Diags; }
+  std::size_t size() const { return Diags.size(); }
+
+private:
+  SmallVector<Diagnostic, 0> Diags;
+};
+
 class DiagnosticsEngine {
 public:
   DiagnosticsEngine(DiagnosticConsumer *Client) : Client(Client) {}
 
   unsigned getNumErrors() const { return NumErrors; }
+  unsigned getNumWarnings() const { return NumWarnings; }
+
+  /// Maximum number of errors to report, 0 for no limit. Once an error past
+  /// the limit is emitted, it and every later diagnostic are dropped.
+  void setErrorLimit(unsigned Limit) { ErrorLimit = Limit; }
+  unsigned getErrorLimit() const { return ErrorLimit; }
+
+  /// Whether diagnostics are being dropped because of the error limit.
+  /// Clients may use it to stop any further analysis.
+  bool hasErrorLimitBeenReached() const { return ErrorLimitReached; }
+
+  /// Forgets the diagnostics emitted so far, e.g. the ones of a previous
+  /// version of the source.
+  void reset() {
+    NumWarnings = NumErrors = 0;
+    ErrorLimitReached = false;
+  }
+
+  DiagnosticConsumer *getClient() const { return Client; }
+
+  /// Replaces the consumer and returns the previous one.
+  DiagnosticConsumer *setClient(DiagnosticConsumer *C) {
+    return std::exchange(Client, C);
+  }
 
   InFlightDiagnostic emitError(SMLoc Loc, unsigned DiagId);
   InFlightDiagnostic emitWarning(SMLoc Loc, unsigned DiagId);
   void report(SourceMgr::DiagKind Kind, SMLoc Loc, StringRef Msg);
 
+  /// Counts and passes on a diagnostic that was emitted by another engine.
+  void forward(const Diagnostic &Diag);
+  /// Takes back the counts of \p Diags, emitted to a consumer that kept them,
+  /// so that they can be forwarded later in another order.
+  void uncount(ArrayRef<Diagnostic> Diags);
+
+private:
+  /// Returns false if a diagnostic of \p Kind must be dropped.
+  bool checkErrorLimit(SourceMgr::DiagKind Kind);
+
 private:
   DiagnosticConsumer *Client;
   unsigned NumWarnings = 0;
   unsigned NumErrors = 0;
+  unsigned ErrorLimit = 0;
+  bool ErrorLimitReached = false;
 };
 
 class InFlightDiagnostic {
 public:
+  /// Creates a diagnostic that is dropped: arguments are ignored and nothing
+  /// is formatted.
+  InFlightDiagnostic() = default;
+
   InFlightDiagnostic(DiagnosticsEngine *DiagEngine, SourceMgr::DiagKind Kind,
                      SMLoc Loc, unsigned DiagId)
       : DiagEngine(DiagEngine), Kind(Kind), Location(Loc), DiagId(DiagId) {}
 
   ~InFlightDiagnostic() { emit(); }
 
-  InFlightDiagnostic &&operator<<(StringRef Arg) {
-    NumArgs++;
-    Args.emplace_back(Arg);
+  /// Arguments are referenced, not copied, until the diagnostic is emitted at
+  /// the end of the statement. Strings that die before, i.e. temporaries, go
+  /// through the std::string overload, which keeps a copy.
+  InFlightDiagnostic &&operator<<(const DiagnosticArgument &Arg) {
+    if (DiagEngine)
+      Args.push_back(Arg);
     return std::move(*this);
   }
 
+  InFlightDiagnostic &&operator<<(StringRef Arg) {
+    return std::move(*this) << DiagnosticArgument(Arg);
+  }
+
+  InFlightDiagnostic &&operator<<(const char *Arg) {
+    return std::move(*this) << DiagnosticArgument(StringRef(Arg));
+  }
+
+  InFlightDiagnostic &&operator<<(std::string &&Arg) {
+    if (!DiagEngine)
+      return std::move(*this);
+    OwnedStrings.push_back(std::make_unique<std::string>(std::move(Arg)));
+    return std::move(*this) << DiagnosticArgument(*OwnedStrings.back());
+  }
+
+  InFlightDiagnostic &&operator<<(int Arg) {
+    return std::move(*this) << DiagnosticArgument(Arg);
+  }
+
 private:
   void emit();
 
-private:
-  static constexpr const int MaxNumArgs = 10;
+  /// Prints \p Format with each {N} replaced by the N-th argument, or the next
+  /// one for {}.
+  void formatMessage(raw_ostream &OS, StringRef Format) const;
 
 private:
-  template <std::size_t... Idx>
-  std::string formatMessage(std::index_sequence<Idx...>, StringRef Format) {
-    return std::string(llvm::formatv(Format.data(), Args[Idx]...));
-  }
+  static constexpr const int MaxNumArgs = 10;
 
 private:
-  DiagnosticsEngine *DiagEngine;
-  SmallVector<std::string, MaxNumArgs> Args;
-  SourceMgr::DiagKind Kind;
+  DiagnosticsEngine *DiagEngine = nullptr;
+  SmallVector<DiagnosticArgument, MaxNumArgs> Args;
+  SmallVector<std::unique_ptr<std::string>, 0> OwnedStrings;
+  SourceMgr::DiagKind Kind = SourceMgr::DK_Error;
   SMLoc Location;
-  unsigned DiagId;
-  unsigned NumArgs = 0;
+  unsigned DiagId = 0;
 };
 
 class TextDiagnosticPrinter final : public DiagnosticConsumer {
@@ -105,4 +213,40 @@ private:
   SourceMgr &SrcMgr;
 };
 
+/// Collects diagnostics and writes them as one JSON or SARIF document when
+/// finish() is called, in a single write to the output stream. Lines and
+/// columns come from a table of line offsets computed once per buffer.
+class JSONDiagnosticPrinter final : public DiagnosticConsumer {
+public:
+  enum class OutputFormat { JSON, SARIF };
+
+  JSONDiagnosticPrinter(SourceMgr &SrcMgr, raw_ostream &OS,
+                        OutputFormat Format)
+      : SrcMgr(SrcMgr), OS(OS), Format(Format) {}
+
+  void handleDiagnostic(const Diagnostic &Diag) override {
+    Diags.push_back(Diag);
+  }
+
+  /// Writes the diagnostics collected so far and forgets them.
+  void finish();
+
+private:
+  void writeJSON(llvm::json::OStream &JOS);
+  void writeSARIF(llvm::json::OStream &JOS);
+  void writeSARIFResult(llvm::json::OStream &JOS, const Diagnostic &D);
+
+  /// Returns the 1-based line and column of \p Loc.
+  std::pair<unsigned, unsigned> getLineAndColumn(SMLoc Loc);
+  StringRef getFileName(SMLoc Loc) const;
+
+private:
+  SourceMgr &SrcMgr;
+  raw_ostream &OS;
+  OutputFormat Format;
+  SmallVector<Diagnostic, 0> Diags;
+  /// Offsets of the line starts, by buffer ID.
+  llvm::DenseMap<unsigned, SmallVector<unsigned, 0>> LineOffsets;
+};
+
 } // namespace chocopy
@@ -1,34 +1,46 @@
 module;
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/PointerIntPair.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/GenericDomTree.h"
+#include "llvm/Support/GenericLoopInfo.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/VersionTuple.h"
 
 
@@ -36,26 +48,37 @@ export module LLVM;
 
 // NOLINTBEGIN(misc-unused-using-decls)
 export namespace llvm {
+using llvm::any_of;
 using llvm::APInt;
+using llvm::append_range;
 using llvm::ArrayRef;
 using llvm::ArrayType;
 using llvm::BasicBlock;
+using llvm::BitVector;
 using llvm::BumpPtrAllocator;
 using llvm::Constant;
 using llvm::ConstantInt;
 using llvm::ConstantPointerNull;
+using llvm::DefaultThreadPool;
 using llvm::DenseMap;
 using llvm::DenseMapInfo;
 using llvm::DenseSet;
+using llvm::DominatorTreeBase;
+using llvm::DomTreeNodeBase;
+using llvm::DomTreeNodeTraits;
+using llvm::drop_begin;
 using llvm::errs;
 using llvm::find_if;
 using llvm::format;
 using llvm::formatv;
 using llvm::Function;
+using llvm::function_ref;
 using llvm::FunctionType;
 using llvm::GlobalValue;
 using llvm::GlobalVariable;
 using llvm::GraphTraits;
+using llvm::hardware_concurrency;
+using llvm::hash_code;
 using llvm::hash_combine;
 using llvm::hash_combine_range;
 using llvm::Inverse;
@@ -63,18 +86,26 @@ using llvm::IRBuilder;
 using llvm::isa;
 using llvm::iterator_range;
 using llvm::LLVMContext;
+using llvm::LoopBase;
+using llvm::LoopInfoBase;
 using llvm::make_const_ptr;
 using llvm::make_range;
 using llvm::Module;
 using llvm::nulls;
 using llvm::outs;
+using llvm::PHINode;
 using llvm::PointerIntPair;
 using llvm::PointerType;
+using llvm::PoisonValue;
+using llvm::predecessors;
 using llvm::raw_fd_ostream;
 using llvm::raw_string_ostream;
 using llvm::raw_svector_ostream;
 using llvm::report_fatal_error;
 using llvm::reverse;
+using llvm::scc_begin;
+using llvm::scc_end;
+using llvm::scc_iterator;
 using llvm::SmallPtrSet;
 using llvm::SmallString;
 using llvm::SmallVector;
@@ -84,13 +115,19 @@ using llvm::SourceMgr;
 using llvm::StringMap;
 using llvm::StringMapEntry;
 using llvm::StringRef;
+using llvm::StringSet;
 using llvm::MemoryBuffer;
 using llvm::StringSwitch;
 using llvm::StructType;
+using llvm::TimeRegion;
+using llvm::Timer;
+using llvm::TimerGroup;
 using llvm::Twine;
 using llvm::Type;
 using llvm::TypeSwitch;
 using llvm::Value;
+using llvm::WeakTrackingVH;
+using llvm::WriteBitcodeToFile;
 
 using llvm::operator==;
 using llvm::operator!=;
@@ -119,6 +156,7 @@ using llvm::json::OStream;
 };
 
 export namespace llvm::sys::fs {
+using llvm::sys::fs::OF_None;
 using llvm::sys::fs::OF_Text;
 };
 
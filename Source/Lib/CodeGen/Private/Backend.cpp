@@ -0,0 +1,153 @@
+module;
+
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
+
+module CodeGen;
+import Basic;
+import std;
+import :Backend;
+
+namespace chocopy {
+static std::unique_ptr<llvm::TargetMachine>
+createHostTargetMachine(std::string &Error) {
+  static std::once_flag InitOnce;
+  std::call_once(InitOnce, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+
+  std::string Triple = llvm::sys::getDefaultTargetTriple();
+  const llvm::Target *T = llvm::TargetRegistry::lookupTarget(Triple, Error);
+  if (!T)
+    return nullptr;
+  // Position independent code links into the PIE executables that most
+  // systems default to.
+  return std::unique_ptr<llvm::TargetMachine>(T->createTargetMachine(
+      Triple, llvm::sys::getHostCPUName(), "", llvm::TargetOptions(),
+      llvm::Reloc::PIC_));
+}
+
+/// Sets the triple and data layout of \p M to those of \p TM.
+static void setTarget(llvm::Module &M, const llvm::TargetMachine &TM) {
+  M.setTargetTriple(TM.getTargetTriple().str());
+  M.setDataLayout(TM.createDataLayout());
+}
+
+bool optimizeModule(llvm::Module &M, const OptimizationOptions &Opts,
+                    std::string &Error) {
+  std::unique_ptr<llvm::TargetMachine> TM = createHostTargetMachine(Error);
+  if (!TM)
+    return false;
+  setTarget(M, *TM);
+
+  llvm::TimePassesIsEnabled = Opts.TimePasses;
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+  llvm::PassInstrumentationCallbacks PIC;
+  llvm::StandardInstrumentations SI(M.getContext(), /*DebugLogging=*/false);
+  SI.registerCallbacks(PIC, &MAM);
+
+  llvm::PassBuilder PB(TM.get(), llvm::PipelineTuningOptions(), std::nullopt,
+                       &PIC);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  llvm::ModulePassManager MPM;
+  switch (Opts.Level) {
+  case 0:
+    MPM = PB.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+    break;
+  case 1: {
+    llvm::FunctionPassManager FPM;
+    FPM.addPass(llvm::PromotePass());
+    FPM.addPass(llvm::InstCombinePass());
+    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(FPM)));
+    break;
+  }
+  case 2:
+    MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+    break;
+  default:
+    MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+    break;
+  }
+
+  if (Opts.PrintPipeline) {
+    MPM.printPipeline(llvm::outs(), [&](StringRef ClassName) {
+      StringRef PassName = PIC.getPassNameForClassName(ClassName);
+      return PassName.empty() ? ClassName : PassName;
+    });
+    llvm::outs() << "\n";
+  }
+  MPM.run(M, MAM);
+  return true;
+}
+
+bool emitNativeCode(llvm::Module &M, BackendOutput Kind,
+                    raw_pwrite_stream &OS, std::string &Error) {
+  std::unique_ptr<llvm::TargetMachine> TM = createHostTargetMachine(Error);
+  if (!TM)
+    return false;
+  setTarget(M, *TM);
+
+  llvm::legacy::PassManager PM;
+  llvm::CodeGenFileType FileType = Kind == BackendOutput::Assembly
+                                       ? llvm::CodeGenFileType::AssemblyFile
+                                       : llvm::CodeGenFileType::ObjectFile;
+  if (TM->addPassesToEmitFile(PM, OS, nullptr, FileType)) {
+    Error = "the host target cannot emit this file type";
+    return false;
+  }
+  PM.run(M);
+  return true;
+}
+
+bool emitExecutable(llvm::Module &M, StringRef Runtime, StringRef OutputFile,
+                    std::string &Error) {
+  int FD;
+  SmallString<128> ObjectFile;
+  if (std::error_code EC =
+          llvm::sys::fs::createTemporaryFile("chocopy", "o", FD, ObjectFile)) {
+    Error = EC.message();
+    return false;
+  }
+  llvm::FileRemover RemoveObject(ObjectFile);
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    if (!emitNativeCode(M, BackendOutput::Object, OS, Error))
+      return false;
+  }
+
+  llvm::ErrorOr<std::string> Linker = llvm::sys::findProgramByName("cc");
+  if (!Linker) {
+    Error = "cannot find the system compiler driver 'cc'";
+    return false;
+  }
+  StringRef Args[] = {*Linker, ObjectFile, Runtime, "-o", OutputFile};
+  if (llvm::sys::ExecuteAndWait(*Linker, Args, std::nullopt, {}, 0, 0,
+                                &Error) != 0) {
+    if (Error.empty())
+      Error = "linking failed";
+    return false;
+  }
+  return true;
+}
+} // namespace chocopy
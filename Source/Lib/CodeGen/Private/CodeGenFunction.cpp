@@ -1,6 +1,8 @@
 module;
 #include <cassert>
+#include "llvm/IR/CallingConv.h"
 module CodeGen;
+import Analysis;
 import Basic;
 import AST;
 import std;
@@ -9,6 +11,12 @@ import :CodeGenFunction;
 
 namespace chocopy {
 namespace codegen {
+static ValueType *getDeclType(ASTContext &Ctx, Declaration *D) {
+  if (auto *P = dyn_cast<ParamDecl>(D))
+    return Ctx.convertAnnotationToVType(P->getType());
+  return Ctx.convertAnnotationToVType(cast<VarDef>(D)->getType());
+}
+
 void CodeGenFunction::emitMain() {
   llvm::LLVMContext &C = CGM.getContext();
   llvm::FunctionType *MainTy = llvm::FunctionType::get(CGM.getVoidTy(), {});
@@ -18,71 +26,326 @@ void CodeGenFunction::emitMain() {
   BB = llvm::BasicBlock::Create(C, "Entry", Fn);
 
   Builder.SetInsertPoint(BB);
-  Builder.SetInsertPoint(Builder.CreateRetVoid());
+  sealBlock(BB);
 }
 
 void CodeGenFunction::emit() {
   assert(F);
-  llvm::report_fatal_error(
-      "Functions are not supported by codegen! Add support");
+  ASTContext &Ctx = CGM.getASTContext();
+  Fn = CGM.getFunction(F);
+  BB = llvm::BasicBlock::Create(CGM.getContext(), "Entry", Fn);
+  Builder.SetInsertPoint(BB);
+  sealBlock(BB);
+
+  SmallVector<Declaration *, 8> Vars;
+  SmallVector<FuncDef *, 4> Nested;
+  for (ParamDecl *P : F->getParams()) {
+    Decls[P->getSymbolInfo()] = P;
+    Vars.push_back(P);
+  }
+  for (Declaration *D : F->getDeclarations()) {
+    if (isa<GlobalDecl>(D)) {
+      GlobalNames.insert(D->getSymbolInfo());
+      continue;
+    }
+    // The variable is found in the enclosing functions.
+    if (isa<NonLocalDecl>(D))
+      continue;
+    Decls[D->getSymbolInfo()] = D;
+    if (isa<VarDef>(D))
+      Vars.push_back(D);
+    else if (auto *N = dyn_cast<FuncDef>(D))
+      Nested.push_back(N);
+  }
+
+  // Only the variables no nested function refers to stay in SSA form.
+  Cfg = CFG::buildCFG(F);
+  if (!Nested.empty()) {
+    llvm::DenseSet<const SymbolInfo *> Locals = Cfg->collectLocalNames();
+    SmallVector<llvm::Type *, 8> Fields = {CGM.getPtrTy()};
+    for (Declaration *D : Vars)
+      if (!Locals.contains(D->getSymbolInfo())) {
+        EnvSlots[D] = Fields.size();
+        Fields.push_back(CGM.convertType(getDeclType(Ctx, D)));
+      }
+    EnvTy = llvm::StructType::get(CGM.getContext(), Fields);
+    Env = Builder.CreateAlloca(EnvTy, nullptr, "env");
+  }
+
+  unsigned ArgNo = 0;
+  if (Parent) {
+    StaticLink = Fn->getArg(ArgNo++);
+    StaticLink->setName("static.link");
+  }
+  if (Env)
+    Builder.CreateStore(StaticLink ? StaticLink
+                                   : llvm::ConstantPointerNull::get(
+                                         CGM.getPtrTy()),
+                        Builder.CreateStructGEP(EnvTy, Env, 0));
+
+  for (Declaration *D : Vars) {
+    llvm::Value *Init;
+    if (auto *V = dyn_cast<VarDef>(D)) {
+      Literal *L = V->getValue();
+      Init = emitConversion(CGM.convertLiteral(L), getType(L),
+                            getDeclType(Ctx, V), L);
+    } else {
+      Init = Fn->getArg(ArgNo++);
+      Init->setName(D->getName());
+    }
+    if (EnvSlots.contains(D))
+      Builder.CreateStore(Init, getAddress(D, this));
+    else
+      addLocal(D, Init);
+  }
+
+  // The same analyses as for main, see CodeGenModule::release(). They only
+  // live while the body is emitted.
+  ConstantPropagation Propagation(*Cfg, CGM.getCallClobberedNames());
+  setConstants(&Propagation);
+  CFGLoopAnalysis Loops(*Cfg);
+  LiveVariables Liveness(*Cfg);
+  EscapeAnalysis Escaping(*Cfg, Ctx, Loops, Liveness);
+  setEscapes(&Escaping);
+  VariableUsage Stores(*Cfg, Liveness);
+  setVariableUsage(&Stores);
+
+  emitStmts(F->getStatements());
+  finishFunction();
+  setConstants(nullptr);
+  setEscapes(nullptr);
+  setVariableUsage(nullptr);
+
+  for (FuncDef *N : Nested)
+    CodeGenFunction(CGM, N, this).emit();
+}
+
+void CodeGenFunction::finishFunction() {
+  if (Builder.GetInsertBlock()->getTerminator())
+    return;
+  llvm::Type *RetTy = Fn->getReturnType();
+  if (RetTy->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(llvm::Constant::getNullValue(RetTy));
 }
 
 void CodeGenFunction::emitDeclaration(Declaration *D) { assert(BB); }
 
 void CodeGenFunction::emitAssignStmt(AssignStmt *A) {
-  llvm::Value *V = emitExpr(A->getValue());
-  for (Expr *TExpr : A->getTargets()) {
-    llvm::Value *T =
-        llvm::TypeSwitch<Expr *, llvm::Value *>(TExpr)
-            .Case([this](DeclRef *D) { return emitDeclRef(D, false); })
-            .Default([](auto) {
-              llvm::report_fatal_error("Unsupported target! Add support...");
-              return nullptr;
-            });
-    Builder.CreateStore(V, T);
+  Expr *Value = A->getValue();
+  llvm::Value *V = emitExpr(Value);
+  ValueType *VT = getType(Value);
+  for (Expr *Target : A->getTargets()) {
+    auto *D = dyn_cast<DeclRef>(Target);
+    if (D && Usage && Usage->isDeadStore(D))
+      continue;
+    emitStore(Target, emitConversion(V, VT, getType(Target), Value));
   }
 }
 
+void CodeGenFunction::emitStore(Expr *Target, llvm::Value *V) {
+  llvm::TypeSwitch<Expr *>(Target)
+      .Case([&](DeclRef *D) {
+        CodeGenFunction *Owner;
+        Declaration *Decl = lookup(D->getSymbolInfo(), Owner);
+        if (isLocal(Decl))
+          writeLocal(Decl, Builder.GetInsertBlock(), V);
+        else
+          Builder.CreateStore(V, getAddress(Decl, Owner));
+      })
+      .Case([&](MemberExpr *M) {
+        Builder.CreateStore(V, emitMemberExpr(M, false));
+      })
+      .Default([this](Expr *E) {
+        reportUnsupported(E->getLocation().Start,
+                          "assignment to list elements");
+      });
+}
+
 void CodeGenFunction::emitStmt(Stmt *S) {
   assert(BB);
+  if (Constants && !Constants->isExecuted(S))
+    return;
   llvm::TypeSwitch<Stmt *>(S)
       .Case([this](AssignStmt *A) { emitAssignStmt(A); })
       .Case([this](ExprStmt *E) { emitExpr(E->getExpr()); })
-      .Default([](auto) {
-        llvm::report_fatal_error("Unsupported statement! Add support...");
+      .Case([this](IfStmt *I) { emitIfStmt(I); })
+      .Case([this](WhileStmt *W) { emitWhileStmt(W); })
+      .Case([this](ReturnStmt *R) { emitReturnStmt(R); })
+      .Case([](PassStmt *) {})
+      .Default([this](Stmt *S) {
+        reportUnsupported(S->getLocation().Start, "for statements");
       });
 }
 
+void CodeGenFunction::emitStmts(ArrayRef<Stmt *> Stmts) {
+  for (Stmt *S : Stmts)
+    emitStmt(S);
+}
+
+void CodeGenFunction::emitBlock(llvm::BasicBlock *Block) {
+  Block->insertInto(Fn);
+  Builder.SetInsertPoint(Block);
+}
+
+void CodeGenFunction::emitIfStmt(IfStmt *I) {
+  llvm::LLVMContext &C = CGM.getContext();
+  auto *Then = llvm::BasicBlock::Create(C, "if.then");
+  auto *Else = I->getElseBody().empty()
+                   ? nullptr
+                   : llvm::BasicBlock::Create(C, "if.else");
+  auto *End = llvm::BasicBlock::Create(C, "if.end");
+  Builder.CreateCondBr(emitExpr(I->getCondition()), Then, Else ? Else : End);
+
+  emitBlock(Then);
+  sealBlock(Then);
+  emitStmts(I->getThenBody());
+  Builder.CreateBr(End);
+
+  if (Else) {
+    emitBlock(Else);
+    sealBlock(Else);
+    emitStmts(I->getElseBody());
+    Builder.CreateBr(End);
+  }
+
+  emitBlock(End);
+  sealBlock(End);
+}
+
+void CodeGenFunction::emitWhileStmt(WhileStmt *W) {
+  llvm::LLVMContext &C = CGM.getContext();
+  auto *Cond = llvm::BasicBlock::Create(C, "while.cond");
+  auto *Body = llvm::BasicBlock::Create(C, "while.body");
+  auto *End = llvm::BasicBlock::Create(C, "while.end");
+  Builder.CreateBr(Cond);
+
+  // The back edge is not known until the body is emitted.
+  emitBlock(Cond);
+  Builder.CreateCondBr(emitExpr(W->getCondition()), Body, End);
+
+  emitBlock(Body);
+  sealBlock(Body);
+  emitStmts(W->getBody());
+  Builder.CreateBr(Cond);
+  sealBlock(Cond);
+
+  emitBlock(End);
+  sealBlock(End);
+}
+
+void CodeGenFunction::emitReturnStmt(ReturnStmt *R) {
+  assert(F && "Return outside of a function!");
+  if (Expr *V = R->getValue())
+    Builder.CreateRet(
+        emitConversion(emitExpr(V), getType(V), CGM.getReturnType(F), V));
+  else
+    Builder.CreateRet(llvm::Constant::getNullValue(Fn->getReturnType()));
+
+  // What follows the return is unreachable.
+  auto *Cont = llvm::BasicBlock::Create(CGM.getContext(), "return.cont");
+  emitBlock(Cont);
+  sealBlock(Cont);
+}
+
 llvm::Value *CodeGenFunction::emitExpr(Expr *E) {
+  if (llvm::Constant *C = emitConstant(E))
+    return C;
   return llvm::TypeSwitch<Expr *, llvm::Value *>(E)
       .Case([this](DeclRef *D) { return emitDeclRef(D); })
       .Case([this](BinaryExpr *B) { return emitBinaryExpr(B); })
+      .Case([this](UnaryExpr *U) { return emitUnaryExpr(U); })
+      .Case([this](IfExpr *I) { return emitIfExpr(I); })
       .Case([this](CallExpr *C) { return emitCallExpr(C); })
+      .Case([this](MethodCallExpr *M) { return emitMethodCallExpr(M); })
+      .Case([this](MemberExpr *M) { return emitMemberExpr(M); })
       .Case([this](IntegerLiteral *I) { return emitIntLiteral(I); })
-      .Default([](auto) {
-        llvm::report_fatal_error("Unsupported expression!");
-        return nullptr;
-      });
+      .Case([this](Literal *L) { return CGM.convertLiteral(L); })
+      .Default([this](Expr *E) { return emitUnsupported(E, "lists"); });
+}
+
+void CodeGenFunction::reportUnsupported(SMLoc Loc, StringRef What) {
+  CGM.getDiagnostics().emitError(Loc, diag::err_codegen_unsupported) << What;
+}
+
+llvm::Value *CodeGenFunction::emitUnsupported(Expr *E, StringRef What) {
+  reportUnsupported(E->getLocation().Start, What);
+  return llvm::PoisonValue::get(CGM.convertType(getType(E)));
+}
+
+llvm::Constant *CodeGenFunction::emitConstant(Expr *E) {
+  if (!Constants)
+    return nullptr;
+  ConstantValue V = Constants->getValue(E);
+  if (V.isInt())
+    return Builder.getInt32(V.getIntValue());
+  if (V.isBool())
+    return Builder.getInt1(V.getBoolValue());
+  return nullptr;
+}
+
+Declaration *CodeGenFunction::lookup(const SymbolInfo *SI,
+                                     CodeGenFunction *&Owner) {
+  for (CodeGenFunction *CGF = this; CGF && CGF->F; CGF = CGF->Parent) {
+    if (CGF->GlobalNames.contains(SI))
+      break;
+    if (Declaration *D = CGF->Decls.lookup(SI)) {
+      Owner = CGF;
+      return D;
+    }
+  }
+  Owner = nullptr;
+  return CGM.lookupGlobal(SI);
+}
+
+llvm::Value *CodeGenFunction::getEnvironment(CodeGenFunction *Owner) {
+  if (Owner == this)
+    return Env;
+  llvm::Value *Link = StaticLink;
+  for (CodeGenFunction *CGF = Parent; CGF != Owner; CGF = CGF->Parent)
+    Link = Builder.CreateLoad(CGM.getPtrTy(),
+                              Builder.CreateStructGEP(CGF->EnvTy, Link, 0));
+  return Link;
+}
+
+llvm::Value *CodeGenFunction::getAddress(Declaration *D,
+                                         CodeGenFunction *Owner) {
+  if (!Owner)
+    return CGM.getModule().getGlobalVariable(CGM.getFQName(D), true);
+  assert(Owner->EnvSlots.contains(D) && "Variable is kept in SSA form!");
+  return Builder.CreateStructGEP(Owner->EnvTy, getEnvironment(Owner),
+                                 Owner->EnvSlots.lookup(D));
 }
 
 llvm::Value *CodeGenFunction::emitDeclRef(DeclRef *D, bool LoadVal) {
-  llvm::Type *Ty = CGM.convertType(D->getInferredType());
-  VarDef *VD = cast<VarDef>(D->getDeclInfo());
-  StringRef Name = CGM.getFQName(VD);
-  llvm::Value *V = CGM.getModule().getGlobalVariable(Name, true);
+  CodeGenFunction *Owner;
+  Declaration *Decl = lookup(D->getSymbolInfo(), Owner);
+  if (!isa_and_present<VarDef, ParamDecl>(Decl))
+    llvm::report_fatal_error("Reference to unsupported declaration!");
+  llvm::Type *Ty = CGM.convertType(getDeclType(CGM.getASTContext(), Decl));
+  if (LoadVal && isLocal(Decl))
+    return readLocal(Decl, Ty, Builder.GetInsertBlock());
+  llvm::Value *V = getAddress(Decl, Owner);
   return LoadVal ? Builder.CreateLoad(Ty, V) : V;
 }
 
 llvm::Value *CodeGenFunction::emitBinaryExpr(BinaryExpr *B) {
+  if (B->getOpKind() == BinaryExpr::OpKind::And ||
+      B->getOpKind() == BinaryExpr::OpKind::Or)
+    return emitLogicalExpr(B);
+
+  ValueType *LTy = getType(B->getLeft());
   llvm::Value *L = emitExpr(B->getLeft());
   llvm::Value *R = emitExpr(B->getRight());
+  bool IsUnboxed = LTy->isInt() || LTy->isBool();
 
   switch (B->getOpKind()) {
-  case BinaryExpr::OpKind::And:
-    return Builder.CreateAnd(L, R);
-  case BinaryExpr::OpKind::Or:
-    return Builder.CreateOr(L, R);
   case BinaryExpr::OpKind::Add:
+    if (LTy->isStr())
+      return Builder.CreateCall(CGM.getStrConcatFn(), {L, R});
+    if (!LTy->isInt())
+      return emitUnsupported(B, "list concatenation");
     return Builder.CreateAdd(L, R);
   case BinaryExpr::OpKind::Sub:
     return Builder.CreateSub(L, R);
@@ -90,49 +353,441 @@ llvm::Value *CodeGenFunction::emitBinaryExpr(BinaryExpr *B) {
     return Builder.CreateMul(L, R);
   case BinaryExpr::OpKind::FloorDiv:
   case BinaryExpr::OpKind::Mod:
+    return emitDivMod(B, L, R);
   case BinaryExpr::OpKind::EqCmp:
+    if (!IsUnboxed)
+      return Builder.CreateCall(CGM.getStrEqFn(), {L, R});
+    return Builder.CreateICmpEQ(L, R);
   case BinaryExpr::OpKind::NEqCmp:
+    if (!IsUnboxed)
+      return Builder.CreateNot(Builder.CreateCall(CGM.getStrEqFn(), {L, R}));
+    return Builder.CreateICmpNE(L, R);
   case BinaryExpr::OpKind::LEqCmp:
+    return Builder.CreateICmpSLE(L, R);
   case BinaryExpr::OpKind::GEqCmp:
+    return Builder.CreateICmpSGE(L, R);
   case BinaryExpr::OpKind::LCmp:
+    return Builder.CreateICmpSLT(L, R);
   case BinaryExpr::OpKind::GCmp:
+    return Builder.CreateICmpSGT(L, R);
   case BinaryExpr::OpKind::Is:
-    llvm::report_fatal_error("Unsupported binary expression!");
-    return nullptr;
+    return Builder.CreateICmpEQ(L, R);
+  case BinaryExpr::OpKind::And:
+  case BinaryExpr::OpKind::Or:
+    break;
   }
+  llvm::report_fatal_error("Unsupported binary expression!");
+  return nullptr;
+}
+
+llvm::Value *CodeGenFunction::emitLogicalExpr(BinaryExpr *B) {
+  // The right operand is only evaluated if the left one does not decide.
+  bool IsAnd = B->getOpKind() == BinaryExpr::OpKind::And;
+  llvm::LLVMContext &C = CGM.getContext();
+  auto *RHS = llvm::BasicBlock::Create(C, IsAnd ? "and.rhs" : "or.rhs");
+  auto *End = llvm::BasicBlock::Create(C, IsAnd ? "and.end" : "or.end");
+
+  llvm::Value *L = emitExpr(B->getLeft());
+  llvm::BasicBlock *LHSBlock = Builder.GetInsertBlock();
+  if (IsAnd)
+    Builder.CreateCondBr(L, RHS, End);
+  else
+    Builder.CreateCondBr(L, End, RHS);
+
+  emitBlock(RHS);
+  sealBlock(RHS);
+  llvm::Value *R = emitExpr(B->getRight());
+  llvm::BasicBlock *RHSBlock = Builder.GetInsertBlock();
+  Builder.CreateBr(End);
+
+  emitBlock(End);
+  sealBlock(End);
+  llvm::PHINode *Phi = Builder.CreatePHI(CGM.getI1Ty(), 2);
+  Phi->addIncoming(Builder.getInt1(!IsAnd), LHSBlock);
+  Phi->addIncoming(R, RHSBlock);
+  return Phi;
+}
+
+llvm::Value *CodeGenFunction::emitDivMod(BinaryExpr *B, llvm::Value *L,
+                                         llvm::Value *R) {
+  emitAbortIf(Builder.CreateICmpEQ(R, Builder.getInt32(0)),
+              "Division by zero");
+
+  // Dividing the smallest int by -1 overflows, which sdiv and srem leave
+  // undefined. The quotient wraps around as in constant propagation, and any
+  // division by -1 has remainder 0, so it is done by 1 and negated instead.
+  llvm::Value *IsNegOne = Builder.CreateICmpEQ(R, Builder.getInt32(-1));
+  llvm::Value *Divisor = Builder.CreateSelect(IsNegOne, Builder.getInt32(1), R);
+
+  // The quotient rounds toward negative infinity, so the remainder has the
+  // sign of the divisor.
+  llvm::Value *Quot = Builder.CreateSDiv(L, Divisor);
+  Quot = Builder.CreateSelect(IsNegOne, Builder.CreateNeg(Quot), Quot);
+  llvm::Value *Rem = Builder.CreateSRem(L, Divisor);
+  llvm::Value *Adjust = Builder.CreateAnd(
+      Builder.CreateICmpNE(Rem, Builder.getInt32(0)),
+      Builder.CreateICmpSLT(Builder.CreateXor(Rem, R), Builder.getInt32(0)));
+  if (B->getOpKind() == BinaryExpr::OpKind::FloorDiv)
+    return Builder.CreateSub(Quot,
+                             Builder.CreateZExt(Adjust, CGM.getI32Ty()));
+  return Builder.CreateSelect(Adjust, Builder.CreateAdd(Rem, R), Rem);
+}
+
+llvm::Value *CodeGenFunction::emitUnaryExpr(UnaryExpr *U) {
+  llvm::Value *V = emitExpr(U->getOperand());
+  if (U->getOpKind() == UnaryExpr::OpKind::Not)
+    return Builder.CreateNot(V);
+  return Builder.CreateNeg(V);
+}
+
+llvm::Value *CodeGenFunction::emitIfExpr(IfExpr *I) {
+  ValueType *T = getType(I);
+  llvm::LLVMContext &C = CGM.getContext();
+  auto *Then = llvm::BasicBlock::Create(C, "cond.then");
+  auto *Else = llvm::BasicBlock::Create(C, "cond.else");
+  auto *End = llvm::BasicBlock::Create(C, "cond.end");
+  Builder.CreateCondBr(emitExpr(I->getCondExpr()), Then, Else);
+
+  auto EmitBranch = [&](llvm::BasicBlock *Block, Expr *E) {
+    emitBlock(Block);
+    sealBlock(Block);
+    llvm::Value *V = emitConversion(emitExpr(E), getType(E), T, E);
+    Builder.CreateBr(End);
+    return std::make_pair(V, Builder.GetInsertBlock());
+  };
+  auto [ThenV, ThenBlock] = EmitBranch(Then, I->getThenExpr());
+  auto [ElseV, ElseBlock] = EmitBranch(Else, I->getElseExpr());
+
+  emitBlock(End);
+  sealBlock(End);
+  llvm::PHINode *Phi = Builder.CreatePHI(CGM.convertType(T), 2);
+  Phi->addIncoming(ThenV, ThenBlock);
+  Phi->addIncoming(ElseV, ElseBlock);
+  return Phi;
 }
 
 llvm::Value *CodeGenFunction::emitCallExpr(CallExpr *C) {
-  auto *F = cast<DeclRef>(C->getFunction());
-  if (F->getName() != "print")
+  auto *Callee = dyn_cast<DeclRef>(C->getFunction());
+  if (!Callee)
     llvm::report_fatal_error("Call of unsupported function!");
+  ASTContext &Ctx = CGM.getASTContext();
+  CodeGenFunction *Owner;
+  Declaration *D = lookup(Callee->getSymbolInfo(), Owner);
 
-  auto *A = cast<DeclRef>(C->getArgs().front());
-  auto *ATy = cast<ClassValueType>(A->getInferredType());
+  if (D == Ctx.getPrintFunc()) {
+    // print keeps nothing, an unboxed argument is boxed in the frame.
+    Expr *Arg = C->getArgs().front();
+    ValueType *T = getType(Arg);
+    llvm::Value *O = emitExpr(Arg);
+    if (T->isInt() || T->isBool())
+      O = emitBox(O, T, Arg, /*InFrame=*/true);
+    Builder.CreateCall(CGM.getPrintFn(), O);
+    return llvm::ConstantPointerNull::get(CGM.getPtrTy());
+  }
+  if (auto *Class = dyn_cast_if_present<ClassDef>(D))
+    return emitConstruct(Class, C);
 
-  if (!ATy->isInt())
+  auto *FD = dyn_cast_if_present<FuncDef>(D);
+  if (!FD)
     llvm::report_fatal_error("Call of unsupported function!");
+  if (FD == Ctx.getInputFunc() || FD == Ctx.getLenFunc())
+    return emitUnsupported(C, FD == Ctx.getLenFunc() ? "len" : "input");
+
+  SmallVector<llvm::Value *, 8> Args;
+  if (Owner)
+    Args.push_back(getEnvironment(Owner));
+  ArrayRef<ParamDecl *> Params = FD->getParams();
+  for (unsigned I = 0, E = Params.size(); I != E; ++I) {
+    Expr *Arg = C->getArgs()[I];
+    Args.push_back(emitConversion(emitExpr(Arg), getType(Arg),
+                                  getDeclType(Ctx, Params[I]), Arg));
+  }
+  auto *Call = Builder.CreateCall(CGM.getFunction(FD), Args);
+  Call->setCallingConv(llvm::CallingConv::Fast);
+  return Call;
+}
+
+llvm::Value *CodeGenFunction::emitConstruct(ClassDef *Class, CallExpr *Site) {
+  ASTContext &Ctx = CGM.getASTContext();
+  if (Ctx.isIntClass(Class))
+    return Builder.getInt32(0);
+  if (Ctx.isBoolClass(Class))
+    return Builder.getInt1(false);
+  if (Ctx.isStrClass(Class))
+    return CGM.getStrConstant("");
+
+  const ClassMemberTable *Table = Ctx.getMemberTable(Class);
+  const ClassMemberTable::Member *Init =
+      Table ? Table->lookup(Ctx.getInitSymbol()) : nullptr;
+  FuncDef *InitFD = Init && !Ctx.isObjectClass(Init->Owner)
+                        ? cast<FuncDef>(Init->Decl)
+                        : nullptr;
+
+  // Escape analysis follows the object, not what __init__ does with self.
+  llvm::GlobalVariable *Proto = CGM.getClassPrototype(Class);
+  llvm::Value *O = InitFD ? Builder.CreateCall(CGM.getAllocFn(), Proto)
+                          : emitAlloc(Proto, Site);
+  if (InitFD) {
+    auto *Call = Builder.CreateCall(CGM.getFunction(InitFD), O);
+    Call->setCallingConv(llvm::CallingConv::Fast);
+  }
+  return O;
+}
+
+const ClassMemberTable::Member *
+CodeGenFunction::lookupMember(MemberExpr *M) {
+  ClassDef *Class = CGM.getClass(getType(M->getObject()));
+  const ClassMemberTable *Table =
+      Class ? CGM.getASTContext().getMemberTable(Class) : nullptr;
+  return Table ? Table->lookup(M->getMember()->getSymbolInfo()) : nullptr;
+}
+
+llvm::Value *CodeGenFunction::emitMethodCallExpr(MethodCallExpr *M) {
+  ASTContext &Ctx = CGM.getASTContext();
+  MemberExpr *Method = M->getMethod();
+  const ClassMemberTable::Member *Mem = lookupMember(Method);
+  if (!Mem || !Mem->isMethod())
+    llvm::report_fatal_error("Call of unsupported method!");
+  if (Ctx.isObjectClass(Mem->Owner))
+    return emitUnsupported(M, "methods of object");
+
+  auto *FD = cast<FuncDef>(Mem->Decl);
+  llvm::Value *Self = emitExpr(Method->getObject());
+  emitAbortIf(Builder.CreateIsNull(Self), "Operation on None");
+  SmallVector<llvm::Value *, 8> Args = {Self};
+  ArrayRef<ParamDecl *> Params = FD->getParams();
+  for (unsigned I = 1, E = Params.size(); I != E; ++I) {
+    Expr *Arg = M->getArgs()[I - 1];
+    Args.push_back(emitConversion(emitExpr(Arg), getType(Arg),
+                                  getDeclType(Ctx, Params[I]), Arg));
+  }
+
+  // Without an override below the static type of the receiver, the method
+  // it sees is the one that runs, and the call can be inlined.
+  llvm::Function *Callee = CGM.getFunction(FD);
+  ClassDef *Class = CGM.getClass(getType(Method->getObject()));
+  llvm::CallInst *Call;
+  if (!CGM.isOverridden(Class, Mem->Slot)) {
+    Call = Builder.CreateCall(Callee, Args);
+  } else {
+    llvm::Value *Table = Builder.CreateLoad(
+        CGM.getPtrTy(),
+        Builder.CreateStructGEP(CGM.getObjectHeaderTy(), Self, 2));
+    llvm::Value *Fn = Builder.CreateLoad(
+        CGM.getPtrTy(),
+        Builder.CreateConstInBoundsGEP1_32(CGM.getPtrTy(), Table, Mem->Slot));
+    Call = Builder.CreateCall(Callee->getFunctionType(), Fn, Args);
+  }
+  Call->setCallingConv(llvm::CallingConv::Fast);
+  return Call;
+}
+
+llvm::Value *CodeGenFunction::emitMemberExpr(MemberExpr *M, bool LoadVal) {
+  const ClassMemberTable::Member *Mem = lookupMember(M);
+  if (!Mem || Mem->isMethod())
+    llvm::report_fatal_error("Unsupported member expression!");
 
-  llvm::Value *O = emitCreateInitObj(A);
-  llvm::Function *PF = CGM.getPrintFn();
-  return Builder.CreateCall(PF, O);
+  // Attributes keep their field in subclasses, the static type gives the
+  // layout.
+  ClassDef *Class = CGM.getClass(getType(M->getObject()));
+  llvm::Value *O = emitExpr(M->getObject());
+  emitAbortIf(Builder.CreateIsNull(O), "Operation on None");
+  llvm::Value *Addr = Builder.CreateStructGEP(
+      CGM.getClassType(Class), O, CGM.getFieldIndex(Class, Mem->Slot));
+  if (!LoadVal)
+    return Addr;
+  llvm::Type *Ty =
+      CGM.convertType(getDeclType(CGM.getASTContext(), Mem->Decl));
+  return Builder.CreateLoad(Ty, Addr);
 }
 
 llvm::Value *CodeGenFunction::emitIntLiteral(IntegerLiteral *I) {
   return Builder.getInt32(I->getValue());
 }
 
-llvm::Value *CodeGenFunction::emitCreateInitObj(DeclRef *V) {
-  StringRef VName = CGM.getFQName(V->getDeclInfo());
-  llvm::Module &M = CGM.getModule();
-  llvm::GlobalValue *GV = M.getNamedValue(VName);
-  llvm::Function *F = CGM.getAllocFn();
-  llvm::GlobalValue *IntProto = CGM.getIntProto();
-  llvm::Value *O = Builder.CreateCall(F, IntProto);
-  llvm::Value *DstPtr = Builder.CreateStructGEP(IntProto->getValueType(), O, 1);
-  llvm::Value *Val = Builder.CreateLoad(GV->getValueType(), GV);
-  Builder.CreateStore(Val, DstPtr);
+ValueType *CodeGenFunction::getType(Expr *E) {
+  ASTContext &Ctx = CGM.getASTContext();
+  return llvm::TypeSwitch<Expr *, ValueType *>(E)
+      .Case([&](DeclRef *D) -> ValueType * {
+        CodeGenFunction *Owner;
+        Declaration *Decl = lookup(D->getSymbolInfo(), Owner);
+        if (isa_and_present<VarDef, ParamDecl>(Decl))
+          return getDeclType(Ctx, Decl);
+        return Ctx.getObjectTy();
+      })
+      .Case([&](MemberExpr *M) -> ValueType * {
+        const ClassMemberTable::Member *Mem = lookupMember(M);
+        if (Mem && !Mem->isMethod())
+          return getDeclType(Ctx, Mem->Decl);
+        return Ctx.getObjectTy();
+      })
+      .Case([&](MethodCallExpr *M) -> ValueType * {
+        const ClassMemberTable::Member *Mem = lookupMember(M->getMethod());
+        if (Mem && Mem->isMethod())
+          return CGM.getReturnType(cast<FuncDef>(Mem->Decl));
+        return Ctx.getObjectTy();
+      })
+      .Case([&](CallExpr *C) -> ValueType * {
+        auto *Callee = dyn_cast<DeclRef>(C->getFunction());
+        CodeGenFunction *Owner;
+        Declaration *D =
+            Callee ? lookup(Callee->getSymbolInfo(), Owner) : nullptr;
+        if (auto *FD = dyn_cast_if_present<FuncDef>(D))
+          return CGM.getReturnType(FD);
+        if (auto *Class = dyn_cast_if_present<ClassDef>(D))
+          return Ctx.getClassVType(Class->getName());
+        return Ctx.getObjectTy();
+      })
+      .Case([&](UnaryExpr *U) {
+        return U->getOpKind() == UnaryExpr::OpKind::Not ? Ctx.getBoolTy()
+                                                        : Ctx.getIntTy();
+      })
+      .Case([&](IfExpr *I) -> ValueType * {
+        ValueType *Then = getType(I->getThenExpr());
+        return Then == getType(I->getElseExpr()) ? Then : Ctx.getObjectTy();
+      })
+      .Default([&](Expr *E) -> ValueType * {
+        auto *T = dyn_cast_if_present<ValueType>(E->getInferredType());
+        return T ? T : Ctx.getObjectTy();
+      });
+}
+
+llvm::Value *CodeGenFunction::emitConversion(llvm::Value *V, ValueType *From,
+                                             ValueType *To, const Expr *Site) {
+  bool IsUnboxed = From->isInt() || From->isBool();
+  if (IsUnboxed && !To->isInt() && !To->isBool())
+    return emitBox(V, From, Site);
+  return V;
+}
+
+llvm::Value *CodeGenFunction::emitBox(llvm::Value *V, ValueType *T,
+                                      const Expr *Site, bool InFrame) {
+  llvm::GlobalVariable *Proto =
+      T->isInt() ? CGM.getIntProto() : CGM.getBoolProto();
+  llvm::Value *O = InFrame ? emitFrameAlloc(Proto) : emitAlloc(Proto, Site);
+  Builder.CreateStore(V,
+                      Builder.CreateStructGEP(Proto->getValueType(), O, 1));
   return O;
 }
+
+void CodeGenFunction::emitAbortIf(llvm::Value *Cond, StringRef Message) {
+  llvm::LLVMContext &C = CGM.getContext();
+  auto *Abort = llvm::BasicBlock::Create(C, "abort");
+  auto *Cont = llvm::BasicBlock::Create(C, "cont");
+  Builder.CreateCondBr(Cond, Abort, Cont);
+
+  emitBlock(Abort);
+  sealBlock(Abort);
+  Builder.CreateCall(CGM.getAbortFn(), CGM.getStrConstant(Message));
+  Builder.CreateUnreachable();
+
+  emitBlock(Cont);
+  sealBlock(Cont);
+}
+
+llvm::Value *CodeGenFunction::emitAlloc(llvm::GlobalValue *Proto,
+                                        const Expr *Site) {
+  if (!Escapes || !Escapes->canAllocateOnStack(Site))
+    return Builder.CreateCall(CGM.getAllocFn(), Proto);
+  return emitFrameAlloc(Proto);
+}
+
+llvm::Value *CodeGenFunction::emitFrameAlloc(llvm::GlobalValue *Proto) {
+  // A single slot in the entry block serves every evaluation of the site. It
+  // is initialized from the prototype, as $alloc would.
+  llvm::BasicBlock &Entry = Fn->getEntryBlock();
+  llvm::IRBuilder<> AllocaBuilder(&Entry, Entry.begin());
+  const llvm::DataLayout &DL = CGM.getModule().getDataLayout();
+  llvm::AllocaInst *O = AllocaBuilder.CreateAlloca(Proto->getValueType());
+  Builder.CreateMemCpy(
+      O, O->getAlign(), Proto, Proto->getPointerAlignment(DL),
+      DL.getTypeAllocSize(Proto->getValueType()).getFixedValue());
+  return O;
+}
+
+void CodeGenFunction::addLocal(Declaration *D, llvm::Value *Init) {
+  writeLocal(D, &Fn->getEntryBlock(), Init);
+}
+
+void CodeGenFunction::writeLocal(Declaration *D, llvm::BasicBlock *BB,
+                                 llvm::Value *V) {
+  CurrentDef[D][BB] = V;
+}
+
+llvm::Value *CodeGenFunction::readLocal(Declaration *D, llvm::Type *Ty,
+                                        llvm::BasicBlock *BB) {
+  auto &Defs = CurrentDef[D];
+  if (auto It = Defs.find(BB); It != Defs.end())
+    return It->second;
+  return readLocalRecursive(D, Ty, BB);
+}
+
+llvm::Value *CodeGenFunction::readLocalRecursive(Declaration *D,
+                                                 llvm::Type *Ty,
+                                                 llvm::BasicBlock *BB) {
+  llvm::Value *V;
+  if (!SealedBlocks.contains(BB)) {
+    // The operands are added once all predecessors are known.
+    llvm::IRBuilder<> PhiBuilder(BB, BB->begin());
+    llvm::PHINode *Phi = PhiBuilder.CreatePHI(Ty, 0);
+    IncompletePhis[BB].push_back({D, Phi});
+    V = Phi;
+  } else if (llvm::BasicBlock *Pred = BB->getSinglePredecessor()) {
+    V = readLocal(D, Ty, Pred);
+  } else if (llvm::predecessors(BB).empty()) {
+    // Only the entry block has no predecessors, and it defines every local.
+    V = llvm::PoisonValue::get(Ty);
+  } else {
+    // The phi breaks cycles through loops before its operands are read.
+    llvm::IRBuilder<> PhiBuilder(BB, BB->begin());
+    llvm::PHINode *Phi = PhiBuilder.CreatePHI(Ty, 0);
+    writeLocal(D, BB, Phi);
+    V = addPhiOperands(D, Phi);
+  }
+  writeLocal(D, BB, V);
+  return V;
+}
+
+llvm::Value *CodeGenFunction::addPhiOperands(Declaration *D,
+                                             llvm::PHINode *Phi) {
+  for (llvm::BasicBlock *Pred : llvm::predecessors(Phi->getParent()))
+    Phi->addIncoming(readLocal(D, Phi->getType(), Pred), Pred);
+  return tryRemoveTrivialPhi(Phi);
+}
+
+llvm::Value *CodeGenFunction::tryRemoveTrivialPhi(llvm::PHINode *Phi) {
+  llvm::Value *Same = nullptr;
+  for (llvm::Value *Op : Phi->incoming_values()) {
+    if (Op == Same || Op == Phi)
+      continue;
+    // The phi merges at least two values.
+    if (Same)
+      return Phi;
+    Same = Op;
+  }
+  // The phi is unreachable or only reads itself.
+  if (!Same)
+    Same = llvm::PoisonValue::get(Phi->getType());
+
+  SmallVector<llvm::WeakTrackingVH, 4> Users;
+  for (auto *U : Phi->users())
+    if (U != Phi && isa<llvm::PHINode>(U))
+      Users.emplace_back(U);
+  Phi->replaceAllUsesWith(Same);
+  Phi->eraseFromParent();
+
+  // Phis that used this one may have become trivial.
+  for (llvm::Value *U : Users)
+    if (auto *UserPhi = dyn_cast_if_present<llvm::PHINode>(U))
+      tryRemoveTrivialPhi(UserPhi);
+  return Same;
+}
+
+void CodeGenFunction::sealBlock(llvm::BasicBlock *BB) {
+  for (auto [D, Phi] : IncompletePhis.lookup(BB))
+    addPhiOperands(D, Phi);
+  IncompletePhis.erase(BB);
+  SealedBlocks.insert(BB);
+}
 } // namespace codegen
-} // namespace chocopy
\ No newline at end of file
+} // namespace chocopy
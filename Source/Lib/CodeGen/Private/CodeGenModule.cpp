@@ -1,6 +1,9 @@
 module;
 #include <cassert>
+#include "llvm/IR/CallingConv.h"
+#include "llvm/IR/Constants.h"
 module CodeGen;
+import Analysis;
 import Basic;
 import AST;
 import std;
@@ -9,8 +12,12 @@ import :CodeGenModule;
 
 namespace chocopy {
 namespace codegen {
-CodeGenModule::CodeGenModule(ASTContext &C, llvm::Module &M)
-    : C(C), M(M), LLVMCtx(M.getContext()) {
+/// Class tags of the objects, as the runtime knows them.
+enum ClassTag : int { ObjectTag = 0, IntTag = 1, BoolTag = 2, StrTag = 3 };
+
+CodeGenModule::CodeGenModule(ASTContext &C, llvm::Module &M,
+                             DiagnosticsEngine &Diags)
+    : C(C), M(M), Diags(Diags), LLVMCtx(M.getContext()) {
   VoidTy = llvm::Type::getVoidTy(LLVMCtx);
   I1Ty = llvm::Type::getInt1Ty(LLVMCtx);
   I8Ty = llvm::Type::getInt8Ty(LLVMCtx);
@@ -23,38 +30,393 @@ CodeGenModule::CodeGenModule(ASTContext &C, llvm::Module &M)
 
 void CodeGenModule::release() {
   Program *P = C.getProgram();
+  collectDeclarations(P);
   CodeGenFunction CGF(*this);
   CGF.emitMain();
 
-  for (Declaration *D : P->getDeclarations())
+  // Fold what is known at compile time before LLVM sees it.
+  std::unique_ptr<CFG> Cfg = CFG::buildCFG(P);
+  ConstantPropagation Constants(*Cfg, CallClobbered);
+  CGF.setConstants(&Constants);
+  // Objects that do not outlive main are allocated in its frame.
+  CFGLoopAnalysis Loops(*Cfg);
+  LiveVariables Liveness(*Cfg);
+  EscapeAnalysis Escapes(*Cfg, C, Loops, Liveness);
+  CGF.setEscapes(&Escapes);
+  VariableUsage Usage(*Cfg, Liveness);
+  CGF.setVariableUsage(&Usage);
+
+  // Globals that only main accesses are kept in SSA form instead of memory.
+  // The others exist before any function refers to them.
+  llvm::DenseSet<const SymbolInfo *> Locals = Cfg->collectLocalNames();
+  for (Declaration *D : P->getDeclarations()) {
+    auto *V = dyn_cast<VarDef>(D);
+    if (!V)
+      continue;
+    if (Locals.contains(V->getSymbolInfo())) {
+      ValueType *VT = C.convertAnnotationToVType(V->getType());
+      if (VT->isInt() || VT->isBool()) {
+        CGF.addLocal(V, convertLiteral(V->getValue()));
+        continue;
+      }
+    }
     emitDeclaration(D);
+  }
+  for (Declaration *D : P->getDeclarations())
+    if (!isa<VarDef>(D))
+      emitDeclaration(D);
 
   for (Stmt *S : P->getStatements())
     CGF.emitStmt(S);
+  CGF.finishFunction();
+}
+
+void CodeGenModule::collectDeclarations(Program *P) {
+  for (ClassDef *Class : {C.getObjectClass(), C.getIntClass(), C.getStrClass(),
+                          C.getBoolClass()}) {
+    Globals[Class->getSymbolInfo()] = Class;
+    Classes[Class->getName()] = Class;
+  }
+  for (FuncDef *F : {C.getPrintFunc(), C.getInputFunc(), C.getLenFunc()})
+    Globals[F->getSymbolInfo()] = F;
+  // The predefined classes share the __init__ of object.
+  collectFunctions(C.getObjectClass()->getDeclarations(), C.getObjectClass());
+  ClassTags[C.getObjectClass()] = ObjectTag;
+  ClassTags[C.getIntClass()] = IntTag;
+  ClassTags[C.getBoolClass()] = BoolTag;
+  ClassTags[C.getStrClass()] = StrTag;
+
+  CallClobbered = ConstantPropagation::collectCallClobberedNames(P);
+
+  int Tag = StrTag + 1;
+  for (Declaration *D : P->getDeclarations()) {
+    Globals[D->getSymbolInfo()] = D;
+    if (auto *Class = dyn_cast<ClassDef>(D)) {
+      Classes[Class->getName()] = Class;
+      ClassTags[Class] = Tag++;
+      collectFunctions(Class->getDeclarations(), Class);
+    } else if (auto *F = dyn_cast<FuncDef>(D)) {
+      collectFunctions(F->getDeclarations(), F);
+    }
+  }
+
+  for (Declaration *D : P->getDeclarations())
+    if (auto *Class = dyn_cast<ClassDef>(D))
+      if (Identifier *Super = Class->getSuperClass())
+        if (ClassDef *SuperClass = Classes.lookup(Super->getName()))
+          Subclasses[SuperClass].push_back(Class);
+}
+
+void CodeGenModule::collectFunctions(ArrayRef<Declaration *> Decls,
+                                     Declaration *Parent) {
+  for (Declaration *D : Decls)
+    if (auto *F = dyn_cast<FuncDef>(D)) {
+      Parents[F] = Parent;
+      collectFunctions(F->getDeclarations(), F);
+    }
 }
 
 void CodeGenModule::emitDeclaration(Declaration *D) {
-  VarDef *V = dyn_cast<VarDef>(D);
+  if (auto *F = dyn_cast<FuncDef>(D))
+    return emitFunction(F);
+  if (auto *Class = dyn_cast<ClassDef>(D))
+    return emitClass(Class);
 
-  assert(V && "Chocopy supports only Variable definitions for now!");
+  VarDef *V = dyn_cast<VarDef>(D);
+  assert(V && "Unexpected global declaration!");
 
   StringRef Name = getFQName(V);
   ValueType *VT = C.convertAnnotationToVType(V->getType());
   llvm::Type *T = convertType(VT);
   llvm::Constant *Lit = convertLiteral(V->getValue());
+  if (Lit->getType() != T)
+    Lit = getBoxedConstant(cast<llvm::ConstantInt>(Lit));
   llvm::GlobalVariable *GV = new llvm::GlobalVariable(
       T, false, llvm::GlobalValue::PrivateLinkage, Lit, Name);
   M.insertGlobalVariable(GV);
 }
 
+void CodeGenModule::emitFunction(FuncDef *F) {
+  CodeGenFunction(*this, F).emit();
+}
+
+void CodeGenModule::emitClass(ClassDef *Class) {
+  for (Declaration *D : Class->getDeclarations())
+    if (auto *F = dyn_cast<FuncDef>(D))
+      emitFunction(F);
+}
+
+llvm::Function *CodeGenModule::getFunction(FuncDef *F) {
+  StringRef Name = getFQName(F);
+  if (llvm::Function *Fn = M.getFunction(Name))
+    return Fn;
+
+  SmallVector<llvm::Type *, 8> Params;
+  if (isNested(F))
+    Params.push_back(PtrTy);
+  for (ParamDecl *P : F->getParams())
+    Params.push_back(convertType(C.convertAnnotationToVType(P->getType())));
+  auto *FTy =
+      llvm::FunctionType::get(convertType(getReturnType(F)), Params, false);
+  llvm::Function *Fn = llvm::Function::Create(
+      FTy, llvm::GlobalValue::InternalLinkage, Name, &M);
+  Fn->setCallingConv(llvm::CallingConv::Fast);
+  return Fn;
+}
+
+ValueType *CodeGenModule::getReturnType(FuncDef *F) {
+  TypeAnnotation *T = F->getReturnType();
+  return T ? C.convertAnnotationToVType(T) : C.getNoneTy();
+}
+
+ClassDef *CodeGenModule::getClass(const ValueType *T) const {
+  auto *CT = dyn_cast_if_present<ClassValueType>(T);
+  return CT ? Classes.lookup(CT->getClassName()) : nullptr;
+}
+
+llvm::StructType *CodeGenModule::getClassType(ClassDef *Class) {
+  if (llvm::StructType *T = ClassTypes.lookup(Class))
+    return T;
+
+  // Inherited attributes keep the offset they have in the superclass, so
+  // that its code works on instances of Class.
+  SmallVector<llvm::Type *, 8> Fields = {ObjTy};
+  SmallVector<unsigned, 8> Indices;
+  Identifier *Super = Class->getSuperClass();
+  ClassDef *SuperClass = Super ? Classes.lookup(Super->getName()) : nullptr;
+  if (SuperClass) {
+    ArrayRef<llvm::Type *> Inherited = getClassType(SuperClass)->elements();
+    Fields.assign(Inherited.begin(), Inherited.end());
+    Indices = FieldIndices.lookup(SuperClass);
+  }
+
+  const ClassMemberTable *Table = C.getMemberTable(Class);
+  ArrayRef<ClassMemberTable::Member> Attrs =
+      Table ? Table->attributes() : ArrayRef<ClassMemberTable::Member>();
+  SmallVector<std::pair<llvm::Type *, unsigned>, 8> Own;
+  for (const ClassMemberTable::Member &A : Attrs.drop_front(Indices.size()))
+    Own.push_back({convertType(C.convertAnnotationToVType(
+                       cast<VarDef>(A.Decl)->getType())),
+                   A.Slot});
+  const llvm::DataLayout &DL = M.getDataLayout();
+  std::ranges::stable_sort(Own, std::ranges::greater(), [&](const auto &F) {
+    return DL.getTypeAllocSize(F.first).getFixedValue();
+  });
+
+  Indices.resize(Attrs.size());
+  for (auto [T, Slot] : Own) {
+    Indices[Slot] = Fields.size();
+    Fields.push_back(T);
+  }
+  FieldIndices[Class] = std::move(Indices);
+  return ClassTypes[Class] = llvm::StructType::get(LLVMCtx, Fields);
+}
+
+llvm::GlobalVariable *CodeGenModule::getClassPrototype(ClassDef *Class) {
+  if (C.isIntClass(Class))
+    return IntProto;
+  if (C.isBoolClass(Class))
+    return BoolProto;
+  if (C.isStrClass(Class))
+    return StrProto;
+  if (llvm::GlobalVariable *GV = ClassPrototypes.lookup(Class))
+    return GV;
+
+  // The module gets the data layout of the host only when it is optimized or
+  // emitted, until then the default one stands for 64-bit hosts.
+  llvm::StructType *T = getClassType(Class);
+  auto Size = M.getDataLayout().getTypeAllocSize(T).getFixedValue();
+  SmallVector<llvm::Constant *, 8> Fields = {llvm::ConstantStruct::get(
+      ObjTy, {llvm::ConstantInt::get(I32Ty, ClassTags.lookup(Class)),
+              llvm::ConstantInt::get(I32Ty, Size), getDispatchTable(Class)})};
+  Fields.resize(T->getNumElements());
+  if (const ClassMemberTable *Table = C.getMemberTable(Class))
+    for (const ClassMemberTable::Member &A : Table->attributes()) {
+      llvm::Constant *Init = convertLiteral(cast<VarDef>(A.Decl)->getValue());
+      unsigned Field = getFieldIndex(Class, A.Slot);
+      if (Init->getType() != T->getElementType(Field))
+        Init = getBoxedConstant(cast<llvm::ConstantInt>(Init));
+      Fields[Field] = Init;
+    }
+
+  auto *GV = new llvm::GlobalVariable(
+      M, T, true, llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantStruct::get(T, Fields),
+      getFQName(Class) + ".class.prototype");
+  return ClassPrototypes[Class] = GV;
+}
+
+llvm::GlobalVariable *CodeGenModule::getDispatchTable(ClassDef *Class) {
+  if (llvm::GlobalVariable *GV = DispatchTables.lookup(Class))
+    return GV;
+
+  SmallVector<llvm::Constant *, 8> Methods;
+  if (const ClassMemberTable *Table = C.getMemberTable(Class))
+    for (const ClassMemberTable::Member &M : Table->methods()) {
+      auto *F = cast<FuncDef>(M.Decl);
+      llvm::Function *Fn = getFunction(F);
+      // The methods of object are not part of the program.
+      if (C.isObjectClass(M.Owner) && Fn->empty())
+        CodeGenFunction(*this, F).emit();
+      Methods.push_back(Fn);
+    }
+
+  auto *T = llvm::ArrayType::get(PtrTy, Methods.size());
+  auto *GV = new llvm::GlobalVariable(
+      M, T, true, llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantArray::get(T, Methods),
+      getFQName(Class) + ".dispatch.table");
+  return DispatchTables[Class] = GV;
+}
+
+bool CodeGenModule::isOverridden(ClassDef *Class, unsigned Slot) const {
+  const ClassMemberTable *Table = C.getMemberTable(Class);
+  Declaration *Method = Table->methods()[Slot].Decl;
+  SmallVector<ClassDef *, 8> Worklist(Subclasses.lookup(Class));
+  while (!Worklist.empty()) {
+    ClassDef *Sub = Worklist.pop_back_val();
+    if (C.getMemberTable(Sub)->methods()[Slot].Decl != Method)
+      return true;
+    llvm::append_range(Worklist, Subclasses.lookup(Sub));
+  }
+  return false;
+}
+
+llvm::Constant *CodeGenModule::getStrConstant(StringRef S) {
+  llvm::Constant *&Str = StrConstants[S];
+  if (Str)
+    return Str;
+
+  llvm::StructType *T = getStrType(S.size() + 1);
+  auto Size = M.getDataLayout().getTypeAllocSize(T).getFixedValue();
+  llvm::Constant *Header = llvm::ConstantStruct::get(
+      ObjTy, {llvm::ConstantInt::get(I32Ty, StrTag),
+              llvm::ConstantInt::get(I32Ty, Size),
+              llvm::ConstantPointerNull::get(PtrTy)});
+  llvm::Constant *Init = llvm::ConstantStruct::get(
+      T, {llvm::ConstantStruct::get(
+              StrTy, {Header, llvm::ConstantInt::get(I32Ty, S.size())}),
+          llvm::ConstantDataArray::getString(LLVMCtx, S)});
+  auto *GV = new llvm::GlobalVariable(
+      M, T, true, llvm::GlobalValue::PrivateLinkage, Init, "$str.const");
+  GV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  return Str = GV;
+}
+
+llvm::Constant *CodeGenModule::getBoxedConstant(llvm::ConstantInt *V) {
+  llvm::Constant *&Box = BoxedConstants[V];
+  if (Box)
+    return Box;
+
+  bool IsBool = V->getType() == I1Ty;
+  llvm::StructType *T = IsBool ? BoolTy : IntTy;
+  auto Size = M.getDataLayout().getTypeAllocSize(T).getFixedValue();
+  llvm::Constant *Header = llvm::ConstantStruct::get(
+      ObjTy, {llvm::ConstantInt::get(I32Ty, IsBool ? BoolTag : IntTag),
+              llvm::ConstantInt::get(I32Ty, Size),
+              llvm::ConstantPointerNull::get(PtrTy)});
+  auto *GV = new llvm::GlobalVariable(
+      M, T, true, llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantStruct::get(T, {Header, V}),
+      IsBool ? "$bool.const" : "$int.const");
+  GV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  return Box = GV;
+}
+
+llvm::Function *CodeGenModule::getStrConcatFn() {
+  if (StrConcat)
+    return StrConcat;
+  auto *FTy = llvm::FunctionType::get(PtrTy, {PtrTy, PtrTy}, false);
+  StrConcat = llvm::Function::Create(FTy, llvm::GlobalValue::InternalLinkage,
+                                     "$str.concat", &M);
+  llvm::Value *L = StrConcat->getArg(0);
+  llvm::Value *R = StrConcat->getArg(1);
+  llvm::IRBuilder<> Builder(
+      llvm::BasicBlock::Create(LLVMCtx, "entry", StrConcat));
+
+  // The result is built in the frame and copied by $alloc, which takes the
+  // size of what it copies from the header.
+  unsigned DataOffset = M.getDataLayout().getTypeAllocSize(StrTy);
+  llvm::Value *LLen = Builder.CreateLoad(
+      I32Ty, Builder.CreateStructGEP(StrTy, L, 1), "llen");
+  llvm::Value *RLen = Builder.CreateLoad(
+      I32Ty, Builder.CreateStructGEP(StrTy, R, 1), "rlen");
+  llvm::Value *Len = Builder.CreateAdd(LLen, RLen, "len");
+  llvm::Value *Size =
+      Builder.CreateAdd(Len, llvm::ConstantInt::get(I32Ty, DataOffset + 1));
+  llvm::Value *S = Builder.CreateAlloca(I8Ty, Size, "str");
+  Builder.CreateMemCpy(S, llvm::MaybeAlign(), StrProto, llvm::MaybeAlign(),
+                       DataOffset);
+  llvm::Value *Hdr = Builder.CreateStructGEP(StrTy, S, 0);
+  Builder.CreateStore(Size, Builder.CreateStructGEP(ObjTy, Hdr, 1));
+  Builder.CreateStore(Len, Builder.CreateStructGEP(StrTy, S, 1));
+
+  llvm::Value *Data = Builder.CreateConstInBoundsGEP1_32(I8Ty, S, DataOffset);
+  Builder.CreateMemCpy(
+      Data, llvm::MaybeAlign(),
+      Builder.CreateConstInBoundsGEP1_32(I8Ty, L, DataOffset),
+      llvm::MaybeAlign(), LLen);
+  Builder.CreateMemCpy(
+      Builder.CreateInBoundsGEP(I8Ty, Data, LLen), llvm::MaybeAlign(),
+      Builder.CreateConstInBoundsGEP1_32(I8Ty, R, DataOffset),
+      llvm::MaybeAlign(), RLen);
+  Builder.CreateStore(llvm::ConstantInt::get(I8Ty, 0),
+                      Builder.CreateInBoundsGEP(I8Ty, Data, Len));
+  Builder.CreateRet(Builder.CreateCall(ChpyAlloc, S));
+  return StrConcat;
+}
+
+llvm::Function *CodeGenModule::getStrEqFn() {
+  if (StrEq)
+    return StrEq;
+  auto *FTy = llvm::FunctionType::get(I1Ty, {PtrTy, PtrTy}, false);
+  StrEq = llvm::Function::Create(FTy, llvm::GlobalValue::InternalLinkage,
+                                 "$str.eq", &M);
+  llvm::Value *L = StrEq->getArg(0);
+  llvm::Value *R = StrEq->getArg(1);
+  auto *Entry = llvm::BasicBlock::Create(LLVMCtx, "entry", StrEq);
+  auto *Loop = llvm::BasicBlock::Create(LLVMCtx, "loop", StrEq);
+  auto *Body = llvm::BasicBlock::Create(LLVMCtx, "body", StrEq);
+  auto *Equal = llvm::BasicBlock::Create(LLVMCtx, "equal", StrEq);
+  auto *Differ = llvm::BasicBlock::Create(LLVMCtx, "differ", StrEq);
+  llvm::IRBuilder<> Builder(Entry);
+
+  unsigned DataOffset = M.getDataLayout().getTypeAllocSize(StrTy);
+  llvm::Value *Len = Builder.CreateLoad(
+      I32Ty, Builder.CreateStructGEP(StrTy, L, 1), "len");
+  llvm::Value *RLen = Builder.CreateLoad(
+      I32Ty, Builder.CreateStructGEP(StrTy, R, 1), "rlen");
+  llvm::Value *LData = Builder.CreateConstInBoundsGEP1_32(I8Ty, L, DataOffset);
+  llvm::Value *RData = Builder.CreateConstInBoundsGEP1_32(I8Ty, R, DataOffset);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Len, RLen), Loop, Differ);
+
+  Builder.SetInsertPoint(Loop);
+  llvm::PHINode *I = Builder.CreatePHI(I32Ty, 2, "i");
+  I->addIncoming(I32Zero, Entry);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(I, Len), Equal, Body);
+
+  Builder.SetInsertPoint(Body);
+  llvm::Value *LC =
+      Builder.CreateLoad(I8Ty, Builder.CreateInBoundsGEP(I8Ty, LData, I));
+  llvm::Value *RC =
+      Builder.CreateLoad(I8Ty, Builder.CreateInBoundsGEP(I8Ty, RData, I));
+  I->addIncoming(Builder.CreateAdd(I, llvm::ConstantInt::get(I32Ty, 1)),
+                 Body);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(LC, RC), Loop, Differ);
+
+  Builder.SetInsertPoint(Equal);
+  Builder.CreateRet(Builder.getTrue());
+  Builder.SetInsertPoint(Differ);
+  Builder.CreateRet(Builder.getFalse());
+  return StrEq;
+}
+
 llvm::Type *CodeGenModule::convertType(Type *T) {
   if (auto *V = dyn_cast<ValueType>(T)) {
     if (V->isInt())
       return I32Ty;
     if (V->isBool())
       return I1Ty;
-    if (V->isStr())
-      return I8Ty;
     return PtrTy;
   }
 
@@ -71,10 +433,7 @@ llvm::Constant *CodeGenModule::convertLiteral(Literal *L) {
       })
       .Case(
           [&](NoneLiteral *N) { return llvm::ConstantPointerNull::get(PtrTy); })
-      .Case([&](StringLiteral *S) {
-        llvm::report_fatal_error("Unsupported literal! Add support...");
-        return nullptr;
-      });
+      .Case([&](StringLiteral *S) { return getStrConstant(S->getValue()); });
 }
 
 llvm::StructType *CodeGenModule::getStrType(int Len) {
@@ -88,7 +447,12 @@ StringRef CodeGenModule::getFQName(Declaration *D) {
 
   llvm::SmallString<256> Buf;
   llvm::raw_svector_ostream Out(Buf);
-  Out << "$" << D->getName();
+  // Methods and nested functions are named after what declares them.
+  auto *F = dyn_cast<FuncDef>(D);
+  if (Declaration *Parent = F ? getParent(F) : nullptr)
+    Out << getFQName(Parent) << "." << D->getName();
+  else
+    Out << "$" << D->getName();
   auto It = FQNames.insert(std::make_pair(Buf, D));
   return FQDeclNames[D] = It.first->first();
 }
@@ -111,6 +475,7 @@ void CodeGenModule::emitBuiltins() {
       VoidTy, llvm::ArrayRef<llvm::Type *>{PtrTy}, false);
   ChpyAbort = llvm::Function::Create(
       VoidPtrFTy, llvm::GlobalValue::ExternalLinkage, "$abort", &M);
+  ChpyAbort->setDoesNotReturn();
   ChpyPrint = llvm::Function::Create(
       VoidPtrFTy, llvm::GlobalValue::ExternalLinkage, "$print", &M);
 
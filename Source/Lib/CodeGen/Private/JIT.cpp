@@ -0,0 +1,149 @@
+module;
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/TargetSelect.h"
+
+module CodeGen;
+import Basic;
+import std;
+import :JIT;
+
+namespace chocopy {
+namespace {
+/// The objects of the runtime, laid out as CodeGenModule declares them: a
+/// packed header { i32 tag, i32 size in bytes, ptr dispatch table } followed
+/// by the attributes. Source/Runtime/Runtime.c is the same runtime for the
+/// executables of -fruntime.
+struct [[gnu::packed]] ObjectHeader {
+  std::int32_t Tag;
+  std::int32_t Size;
+  void *DispatchTable;
+};
+
+struct [[gnu::packed]] IntObject {
+  ObjectHeader Header;
+  std::int32_t Value;
+};
+
+struct [[gnu::packed]] BoolObject {
+  ObjectHeader Header;
+  bool Value;
+};
+
+/// The characters follow the length, with a terminating null.
+struct [[gnu::packed]] StrObject {
+  ObjectHeader Header;
+  std::int32_t Length;
+  char Data[1];
+};
+
+enum ClassTag : std::int32_t { IntTag = 1, BoolTag = 2, StrTag = 3 };
+
+IntObject IntPrototype = {{IntTag, sizeof(IntObject), nullptr}, 0};
+BoolObject BoolPrototype = {{BoolTag, sizeof(BoolObject), nullptr}, false};
+StrObject StrPrototype = {{StrTag, sizeof(StrObject), nullptr}, 0, {0}};
+
+/// Set for the duration of runModule.
+llvm::Timer *FirstOutputTimer = nullptr;
+
+void *allocObject(const ObjectHeader *Prototype) {
+  void *O = std::malloc(Prototype->Size);
+  if (!O)
+    llvm::report_fatal_error("out of memory");
+  std::memcpy(O, Prototype, Prototype->Size);
+  return O;
+}
+
+void printObject(const ObjectHeader *O) {
+  if (FirstOutputTimer && FirstOutputTimer->isRunning())
+    FirstOutputTimer->stopTimer();
+
+  llvm::raw_ostream &OS = llvm::outs();
+  switch (O ? O->Tag : 0) {
+  case IntTag:
+    OS << reinterpret_cast<const IntObject *>(O)->Value << "\n";
+    break;
+  case BoolTag:
+    OS << (reinterpret_cast<const BoolObject *>(O)->Value ? "True" : "False")
+       << "\n";
+    break;
+  case StrTag: {
+    auto *S = reinterpret_cast<const StrObject *>(O);
+    OS << StringRef(S->Data, S->Length) << "\n";
+    break;
+  }
+  default:
+    llvm::outs().flush();
+    llvm::errs() << "Invalid argument to print\n";
+    std::exit(1);
+  }
+}
+
+void abortProgram(const StrObject *Message) {
+  llvm::outs().flush();
+  if (Message)
+    llvm::errs() << StringRef(Message->Data, Message->Length) << "\n";
+  std::exit(1);
+}
+} // namespace
+
+bool runModule(std::unique_ptr<llvm::Module> M,
+               std::unique_ptr<llvm::LLVMContext> Ctx, const JITOptions &Opts,
+               std::string &Error) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  auto SetError = [&](llvm::Error E) {
+    Error = llvm::toString(std::move(E));
+    return false;
+  };
+
+  void (*Main)();
+  std::unique_ptr<llvm::orc::LLJIT> J;
+  {
+    llvm::TimeRegion Region(Opts.CompileTimer);
+    llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> JIT =
+        llvm::orc::LLJITBuilder().create();
+    if (!JIT)
+      return SetError(JIT.takeError());
+    J = std::move(*JIT);
+
+    llvm::orc::SymbolMap Runtime;
+    auto Define = [&](StringRef Name, auto *Address) {
+      Runtime[J->mangleAndIntern(Name)] = llvm::orc::ExecutorSymbolDef(
+          llvm::orc::ExecutorAddr::fromPtr(Address),
+          llvm::JITSymbolFlags::Exported);
+    };
+    Define("$alloc", &allocObject);
+    Define("$print", &printObject);
+    Define("$abort", &abortProgram);
+    Define("$int.class.prototype", &IntPrototype);
+    Define("$bool.class.prototype", &BoolPrototype);
+    Define("$str.class.prototype", &StrPrototype);
+    if (llvm::Error E = J->getMainJITDylib().define(
+            llvm::orc::absoluteSymbols(std::move(Runtime))))
+      return SetError(std::move(E));
+
+    if (llvm::Error E = J->addIRModule(
+            llvm::orc::ThreadSafeModule(std::move(M), std::move(Ctx))))
+      return SetError(std::move(E));
+
+    // The module is compiled when Main is first looked up.
+    llvm::Expected<llvm::orc::ExecutorAddr> MainAddr = J->lookup("Main");
+    if (!MainAddr)
+      return SetError(MainAddr.takeError());
+    Main = MainAddr->toPtr<void (*)()>();
+  }
+
+  {
+    SaveAndRestore SaveTimer(FirstOutputTimer, Opts.FirstOutputTimer);
+    llvm::TimeRegion Region(Opts.RunTimer);
+    Main();
+  }
+  if (Opts.FirstOutputTimer && Opts.FirstOutputTimer->isRunning())
+    Opts.FirstOutputTimer->stopTimer();
+  llvm::outs().flush();
+  return true;
+}
+} // namespace chocopy
@@ -8,8 +8,11 @@ namespace chocopy {
 std::unique_ptr<llvm::Module>
 CodeGenerator::handleProgram(Program *Program, std::string FileName) {
   Module.reset(new llvm::Module(FileName, Ctx));
-  Builder.reset(new codegen::CodeGenModule(ASTCtx, *Module));
+  Builder.reset(new codegen::CodeGenModule(ASTCtx, *Module, Diags));
+  unsigned NumErrors = Diags.getNumErrors();
   Builder->release();
+  if (Diags.getNumErrors() != NumErrors)
+    return nullptr;
 
   // for (Declaration *D : Program->getDeclarations())
 //   for (Declaration *D : Program->getDeclarations()) {
@@ -21,7 +24,8 @@ CodeGenerator::handleProgram(Program *Program, std::string FileName) {
 }
 
 std::unique_ptr<CodeGenerator> createLLVMCodegen(llvm::LLVMContext &Ctx,
-                                                 ASTContext &ASTCtx) {
-  return std::make_unique<CodeGenerator>(Ctx, ASTCtx);
+                                                 ASTContext &ASTCtx,
+                                                 DiagnosticsEngine &Diags) {
+  return std::make_unique<CodeGenerator>(Ctx, ASTCtx, Diags);
 }
 } // namespace chocopy
\ No newline at end of file
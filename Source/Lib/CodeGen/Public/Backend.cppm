@@ -0,0 +1,40 @@
+export module CodeGen:Backend;
+import Basic;
+import std;
+
+export namespace chocopy {
+enum class BackendOutput { Assembly, Object };
+
+struct OptimizationOptions {
+  /// 0 to 3, as in -O<N>.
+  unsigned Level = 0;
+  /// Reports the time spent in each pass when the pipeline is done.
+  bool TimePasses = false;
+  /// Prints the textual description of the pipeline before running it.
+  bool PrintPipeline = false;
+};
+
+/// Runs the optimization pipeline of \p Opts over \p M, tuned for the host.
+///
+/// -O2 and -O3 run the default module pipelines of the PassBuilder. -O1 only
+/// promotes locals to registers and combines instructions in each function,
+/// which costs little compile time and removes most of what naive lowering
+/// leaves behind. -O0 runs the O0 pipeline, which only handles
+/// always-inline functions. Returns false and sets \p Error on failure.
+bool optimizeModule(llvm::Module &M, const OptimizationOptions &Opts,
+                    std::string &Error);
+
+/// Compiles \p M for the host with the LLVM backend, in process, and writes
+/// the assembly or object file to \p OS. The triple and data layout of \p M
+/// are set to those of the host. Returns false and sets \p Error on failure.
+bool emitNativeCode(llvm::Module &M, BackendOutput Kind,
+                    raw_pwrite_stream &OS, std::string &Error);
+
+/// Compiles \p M to a temporary object file and links it with \p Runtime,
+/// which provides main and the functions the generated code calls, into the
+/// executable \p OutputFile. Source/Runtime/Runtime.c is such a runtime, a C
+/// source compiled as it is linked. Only linking starts another process, the
+/// system compiler driver.
+bool emitExecutable(llvm::Module &M, StringRef Runtime, StringRef OutputFile,
+                    std::string &Error);
+} // namespace chocopy
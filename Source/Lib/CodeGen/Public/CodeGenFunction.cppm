@@ -1,6 +1,7 @@
 export module CodeGen:CodeGenFunction;
 import :CodeGenModule;
 
+import Analysis;
 import Basic;
 import AST;
 import std;
@@ -10,29 +11,143 @@ namespace codegen {
 class CodeGenFunction {
 public:
   CodeGenFunction(CodeGenModule &CGM) : CGM(CGM), Builder(CGM.getContext()) {}
-  CodeGenFunction(CodeGenModule &CGM, FuncDef *F)
-      : CGM(CGM), Builder(CGM.getContext()), F(F) {}
+  /// \p Parent is the function \p F is nested in, if any.
+  CodeGenFunction(CodeGenModule &CGM, FuncDef *F,
+                  CodeGenFunction *Parent = nullptr)
+      : CGM(CGM), Builder(CGM.getContext()), F(F), Parent(Parent) {}
 
   void emitMain();
   void emit();
+  /// Returns from the function if the last block does not, with the zero
+  /// value of the return type.
+  void finishFunction();
   void emitDeclaration(Declaration *D);
   void emitStmt(Stmt *S);
+  void emitStmts(ArrayRef<Stmt *> Stmts);
   void emitAssignStmt(AssignStmt *A);
+  void emitIfStmt(IfStmt *I);
+  void emitWhileStmt(WhileStmt *W);
+  void emitReturnStmt(ReturnStmt *R);
 
   llvm::Value *emitExpr(Expr *E);
   llvm::Value *emitDeclRef(DeclRef *D, bool LoadVal = true);
   llvm::Value *emitBinaryExpr(BinaryExpr *B);
+  llvm::Value *emitLogicalExpr(BinaryExpr *B);
+  llvm::Value *emitDivMod(BinaryExpr *B, llvm::Value *L, llvm::Value *R);
+  llvm::Value *emitUnaryExpr(UnaryExpr *U);
+  llvm::Value *emitIfExpr(IfExpr *I);
   llvm::Value *emitCallExpr(CallExpr *C);
+  llvm::Value *emitMethodCallExpr(MethodCallExpr *M);
+  llvm::Value *emitMemberExpr(MemberExpr *M, bool LoadVal = true);
   llvm::Value *emitIntLiteral(IntegerLiteral *I);
 
-  llvm::Value *emitCreateInitObj(DeclRef *V);
+  /// Creates an instance of \p Class for the value of \p Site and runs its
+  /// __init__.
+  llvm::Value *emitConstruct(ClassDef *Class, CallExpr *Site);
+  /// Boxes \p V, an int or bool of type \p T, for the value of \p Site. The
+  /// box lives in the frame if \p InFrame, when nothing can keep it.
+  llvm::Value *emitBox(llvm::Value *V, ValueType *T, const Expr *Site,
+                       bool InFrame = false);
+  /// Converts \p V of type \p From for a slot of type \p To. int and bool
+  /// stay in registers and are only boxed when they flow into an object
+  /// slot: a variable, attribute, parameter or result of another type.
+  llvm::Value *emitConversion(llvm::Value *V, ValueType *From, ValueType *To,
+                              const Expr *Site);
+  /// Allocates an object initialized from \p Proto for the value of \p Site,
+  /// in the frame if it does not escape.
+  llvm::Value *emitAlloc(llvm::GlobalValue *Proto, const Expr *Site);
+  /// Allocates an object initialized from \p Proto in a slot of the frame.
+  llvm::Value *emitFrameAlloc(llvm::GlobalValue *Proto);
+  /// Calls $abort with \p Message when \p Cond holds.
+  void emitAbortIf(llvm::Value *Cond, StringRef Message);
+  /// Reports that \p What, at \p Loc, cannot be compiled yet. Emission goes
+  /// on so that every such construct is reported.
+  void reportUnsupported(SMLoc Loc, StringRef What);
+  /// Reports \p E as unsupported and returns a placeholder for its value.
+  llvm::Value *emitUnsupported(Expr *E, StringRef What);
+
+  /// The static type of \p E, from Sema where it records one.
+  ValueType *getType(Expr *E);
+
+  /// Results of constant propagation over the code being emitted. Statements
+  /// that never execute are skipped and constant expressions are folded.
+  void setConstants(const ConstantPropagation *C) { Constants = C; }
+  llvm::Constant *emitConstant(Expr *E);
+
+  /// Results of escape analysis over the code being emitted.
+  void setEscapes(const EscapeAnalysis *E) { Escapes = E; }
+
+  /// Stores whose value is never read are not emitted.
+  void setVariableUsage(const VariableUsage *U) { Usage = U; }
+
+  /// Locals are kept in SSA form as they are emitted, following Braun et al.,
+  /// "Simple and Efficient Construction of Static Single Assignment Form".
+  /// A block is sealed once all of its predecessors are known; reads in
+  /// unsealed blocks create phis that are completed when it is sealed.
+  ///
+  /// \p Init is the value of \p D on entry to the function.
+  void addLocal(Declaration *D, llvm::Value *Init);
+  bool isLocal(Declaration *D) const { return CurrentDef.contains(D); }
+  void writeLocal(Declaration *D, llvm::BasicBlock *BB, llvm::Value *V);
+  llvm::Value *readLocal(Declaration *D, llvm::Type *Ty, llvm::BasicBlock *BB);
+  void sealBlock(llvm::BasicBlock *BB);
+
+private:
+  llvm::Value *readLocalRecursive(Declaration *D, llvm::Type *Ty,
+                                  llvm::BasicBlock *BB);
+  llvm::Value *addPhiOperands(Declaration *D, llvm::PHINode *Phi);
+  /// Replaces \p Phi by its only operand other than itself, if it has one,
+  /// and returns the value that stands for it.
+  llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *Phi);
+
+  /// Finds the declaration \p SI names here. \p Owner is set to the function
+  /// declaring it, null for a global.
+  Declaration *lookup(const SymbolInfo *SI, CodeGenFunction *&Owner);
+  /// The environment of \p Owner, this function or one it is nested in,
+  /// reached through the static links.
+  llvm::Value *getEnvironment(CodeGenFunction *Owner);
+  /// The address of a variable that is not kept in SSA form.
+  llvm::Value *getAddress(Declaration *D, CodeGenFunction *Owner);
+  /// The attribute or method \p M names in the static type of its object.
+  const ClassMemberTable::Member *lookupMember(MemberExpr *M);
+  void emitStore(Expr *Target, llvm::Value *V);
+  /// Appends \p Block to the function and continues there.
+  void emitBlock(llvm::BasicBlock *Block);
 
 private:
   CodeGenModule &CGM;
   llvm::IRBuilder<> Builder;
   FuncDef *F = nullptr;
+  CodeGenFunction *Parent = nullptr;
   llvm::Function *Fn;
   llvm::BasicBlock *BB = nullptr;
+  std::unique_ptr<CFG> Cfg;
+  const ConstantPropagation *Constants = nullptr;
+  const EscapeAnalysis *Escapes = nullptr;
+  const VariableUsage *Usage = nullptr;
+
+  /// The parameters, variables and functions F declares.
+  llvm::DenseMap<const SymbolInfo *, Declaration *> Decls;
+  /// Names F declares global.
+  llvm::DenseSet<const SymbolInfo *> GlobalNames;
+  /// The variables of F that nested functions refer to live in its
+  /// environment, a frame slot { static link, variables... }. The static link
+  /// is the environment of the parent of F. Functions are not values in
+  /// ChocoPy, so no environment outlives its frame.
+  llvm::StructType *EnvTy = nullptr;
+  llvm::Value *Env = nullptr;
+  llvm::Value *StaticLink = nullptr;
+  llvm::DenseMap<Declaration *, unsigned> EnvSlots;
+
+  /// The value of each local at the end of each block that defines it. The
+  /// handles follow the phis that are found trivial and replaced.
+  llvm::DenseMap<Declaration *,
+                 llvm::DenseMap<llvm::BasicBlock *, llvm::WeakTrackingVH>>
+      CurrentDef;
+  llvm::DenseMap<llvm::BasicBlock *,
+                 SmallVector<std::pair<Declaration *, llvm::PHINode *>, 4>>
+      IncompletePhis;
+  llvm::SmallPtrSet<llvm::BasicBlock *, 16> SealedBlocks;
 };
 } // namespace codegen
 } // namespace chocopy
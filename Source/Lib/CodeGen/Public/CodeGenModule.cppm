@@ -12,13 +12,71 @@ export namespace chocopy {
 namespace codegen {
 class CodeGenModule {
 public:
-  CodeGenModule(ASTContext &C, llvm::Module &M);
+  CodeGenModule(ASTContext &C, llvm::Module &M, DiagnosticsEngine &Diags);
   void release();
 
   void emitDeclaration(Declaration *D);
+  /// Emits a function of the program or a method, and the functions nested
+  /// in it.
+  void emitFunction(FuncDef *F);
+  /// Emits the methods of \p C.
+  void emitClass(ClassDef *C);
   llvm::Type *convertType(Type *T);
   llvm::Constant *convertLiteral(Literal *L);
 
+  /// Functions and methods use the fast calling convention, nothing outside
+  /// of the module calls them. A function nested in another one takes the
+  /// environment of its parent as first parameter.
+  llvm::Function *getFunction(FuncDef *F);
+  /// The type of the values F returns, <None> if it is not annotated.
+  ValueType *getReturnType(FuncDef *F);
+  /// The function or class declaring \p F, null for a global function.
+  Declaration *getParent(FuncDef *F) const { return Parents.lookup(F); }
+  bool isNested(FuncDef *F) const {
+    return isa_and_present<FuncDef>(getParent(F));
+  }
+
+  /// The global variable, function or class named \p SI, predefined ones
+  /// included, or null.
+  Declaration *lookupGlobal(const SymbolInfo *SI) const {
+    return Globals.lookup(SI);
+  }
+  /// The names declared global or nonlocal anywhere in the program. A call
+  /// may write them.
+  const llvm::DenseSet<const SymbolInfo *> &getCallClobberedNames() const {
+    return CallClobbered;
+  }
+
+  ClassDef *getClass(const ValueType *T) const;
+  /// { class.object, attributes... }. The fields of the superclass come
+  /// first, in its own layout, then those \p C declares from the largest to
+  /// the smallest. This leaves no padding between the fields \p C declares,
+  /// but there may be some where they start, after those of the superclass.
+  llvm::StructType *getClassType(ClassDef *C);
+  /// The field of getClassType(C) holding the attribute in slot \p Slot of
+  /// the member table of \p C.
+  unsigned getFieldIndex(ClassDef *C, unsigned Slot) {
+    getClassType(C);
+    return FieldIndices.find(C)->second[Slot];
+  }
+  /// The object $alloc copies to create an instance of \p C.
+  llvm::GlobalVariable *getClassPrototype(ClassDef *C);
+  /// The methods of \p C in the slots of its member table. The prototype of
+  /// \p C points to it.
+  llvm::GlobalVariable *getDispatchTable(ClassDef *C);
+  /// Whether a subclass of \p C puts another method in method slot \p Slot.
+  /// If not, a call through the slot on a \p C is a direct call.
+  bool isOverridden(ClassDef *C, unsigned Slot) const;
+  /// A constant str object holding \p S.
+  llvm::Constant *getStrConstant(StringRef S);
+  /// A constant int or bool object holding \p V, the initializer of a
+  /// variable or attribute of type object.
+  llvm::Constant *getBoxedConstant(llvm::ConstantInt *V);
+  /// str $str.concat(str, str), which allocates the result with $alloc.
+  llvm::Function *getStrConcatFn();
+  /// bool $str.eq(str, str), which compares the characters.
+  llvm::Function *getStrEqFn();
+
 public:
   llvm::StructType *getStrType(int Len);
   // Get Fully-Qualified Name for declaration d.
@@ -28,10 +86,15 @@ public:
   llvm::Type *getI1Ty() const { return I1Ty; }
   llvm::Type *getI32Ty() const { return I32Ty; }
   llvm::PointerType *getPtrTy() const { return PtrTy; }
+  /// { i32 tag, i32 size, ptr dispatch table }, the header of every object.
+  llvm::StructType *getObjectHeaderTy() const { return ObjTy; }
 
   llvm::LLVMContext &getContext() const { return LLVMCtx; }
   llvm::Module &getModule() const { return M; }
+  ASTContext &getASTContext() const { return C; }
+  DiagnosticsEngine &getDiagnostics() const { return Diags; }
 
+  llvm::Function *getAbortFn() const { return ChpyAbort; }
   llvm::Function *getAllocFn() const { return ChpyAlloc; }
   llvm::Function *getPrintFn() const { return ChpyPrint; }
 
@@ -41,10 +104,14 @@ public:
 
 private:
   void emitBuiltins();
+  /// Records the globals of \p P and the parent of every function.
+  void collectDeclarations(Program *P);
+  void collectFunctions(ArrayRef<Declaration *> Decls, Declaration *Parent);
 
 private:
   ASTContext &C;
   llvm::Module &M;
+  DiagnosticsEngine &Diags;
   llvm::LLVMContext &LLVMCtx;
   llvm::Type *VoidTy;
   llvm::Type *I1Ty;
@@ -59,10 +126,25 @@ private:
   llvm::Function *ChpyAbort;
   llvm::Function *ChpyPrint;
   llvm::Function *ChpyAlloc;
+  llvm::Function *StrConcat = nullptr;
+  llvm::Function *StrEq = nullptr;
   llvm::GlobalVariable *IntProto;
   llvm::GlobalVariable *BoolProto;
   llvm::GlobalVariable *StrProto;
 
+  llvm::DenseMap<const SymbolInfo *, Declaration *> Globals;
+  llvm::DenseMap<FuncDef *, Declaration *> Parents;
+  llvm::DenseSet<const SymbolInfo *> CallClobbered;
+  llvm::StringMap<ClassDef *> Classes;
+  llvm::DenseMap<ClassDef *, int> ClassTags;
+  llvm::DenseMap<ClassDef *, llvm::StructType *> ClassTypes;
+  llvm::DenseMap<ClassDef *, SmallVector<unsigned, 8>> FieldIndices;
+  llvm::DenseMap<ClassDef *, SmallVector<ClassDef *, 2>> Subclasses;
+  llvm::DenseMap<ClassDef *, llvm::GlobalVariable *> ClassPrototypes;
+  llvm::DenseMap<ClassDef *, llvm::GlobalVariable *> DispatchTables;
+  llvm::StringMap<llvm::Constant *> StrConstants;
+  llvm::DenseMap<llvm::ConstantInt *, llvm::Constant *> BoxedConstants;
+
   llvm::DenseMap<Declaration *, StringRef> FQDeclNames;
   llvm::StringMap<Declaration *, llvm::BumpPtrAllocator> FQNames;
   // llvm::ConstantInt *True;
@@ -1,4 +1,6 @@
 export module CodeGen;
+export import :Backend;
 export import :CodeGenFunction;
 export import :CodeGenModule;
+export import :JIT;
 export import :ModuleBuilder;
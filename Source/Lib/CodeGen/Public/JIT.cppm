@@ -0,0 +1,26 @@
+export module CodeGen:JIT;
+import Basic;
+import std;
+
+export namespace chocopy {
+struct JITOptions {
+  /// Timers of -ftime-report, null when not timed.
+  llvm::Timer *CompileTimer = nullptr;
+  llvm::Timer *RunTimer = nullptr;
+  /// Stopped by the first print of the program, or when it returns without
+  /// printing. The caller starts it as early as it wants latency measured.
+  llvm::Timer *FirstOutputTimer = nullptr;
+};
+
+/// Compiles \p M with the ORC LLJIT for the host and calls its Main, in this
+/// process. The functions and prototypes the generated code refers to,
+/// $alloc, $print, $abort and the $<class>.class.prototype objects, are
+/// resolved against a runtime built into the compiler. Output of the program
+/// goes to stdout.
+///
+/// $abort ends the process. Returns false and sets \p Error if the module
+/// cannot be compiled or has no Main.
+bool runModule(std::unique_ptr<llvm::Module> M,
+               std::unique_ptr<llvm::LLVMContext> Ctx, const JITOptions &Opts,
+               std::string &Error);
+} // namespace chocopy
@@ -7,20 +7,25 @@ import std;
 export namespace chocopy {
 class CodeGenerator {
 public:
-  CodeGenerator(llvm::LLVMContext &Ctx, ASTContext &ASTCtx)
-      : Ctx(Ctx), ASTCtx(ASTCtx) {}
+  CodeGenerator(llvm::LLVMContext &Ctx, ASTContext &ASTCtx,
+                DiagnosticsEngine &Diags)
+      : Ctx(Ctx), ASTCtx(ASTCtx), Diags(Diags) {}
 
+  /// Returns null if \p Program uses what cannot be compiled yet, which is
+  /// reported to the diagnostics engine.
   std::unique_ptr<llvm::Module> handleProgram(Program *Program,
                                               std::string FileName);
 
 private:
   llvm::LLVMContext &Ctx;
   ASTContext &ASTCtx;
+  DiagnosticsEngine &Diags;
 
   std::unique_ptr<llvm::Module> Module;
   std::unique_ptr<codegen::CodeGenModule> Builder;
 };
 
 std::unique_ptr<CodeGenerator> createLLVMCodegen(llvm::LLVMContext &Ctx,
-                                                 ASTContext &ASTCtx);
+                                                 ASTContext &ASTCtx,
+                                                 DiagnosticsEngine &Diags);
 } // namespace chocopy
@@ -51,6 +51,19 @@ void Lexer::reset() {
   initializeSymbolTable(SymbolTable);
 }
 
+void Lexer::enterBuffer(unsigned ID) {
+  CurBuffer = ID;
+  CurBuf = SourceMgr->getMemoryBuffer(ID)->getBuffer();
+  BufEnd = CurBuf.end();
+  IndentStack = {0};
+  DedentCount = 0;
+  IsLogLineStart = false;
+  BufPtr = CurBuf.begin();
+  CurLexerCallback = callbackLexer;
+  CachedTokenPos = 0;
+  CachedTokens.clear();
+}
+
 bool Lexer::lex(Token &Tok) {
   while (!CurLexerCallback(*this, Tok))
     ;
@@ -15,6 +15,10 @@ public:
   SymbolTable &getSymbolTable() { return SymbolTable; }
 
   void reset();
+  /// Continues with the buffer \p ID of the source manager, e.g. an edited
+  /// version of the source. The symbol table is kept, so that names map to
+  /// the same SymbolInfo as before.
+  void enterBuffer(unsigned ID);
 
   /// Lex returns true if function returns Tok
   bool lex(Token &Tok);
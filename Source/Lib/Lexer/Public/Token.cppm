@@ -130,8 +130,12 @@ public:
   }
 
   friend auto operator<<(InFlightDiagnostic &&D, const Token &Tok) -> auto && {
-    // return std::forward<InFlightDiagnostic>(D) << StringRef(Tok);
-    return std::forward<InFlightDiagnostic>(D) << std::string(Tok); // Invoke formatting
+    // The token is only printed if the diagnostic is emitted.
+    return std::move(D) << DiagnosticArgument(
+               DiagnosticArgument::ArgKind::Token, &Tok,
+               [](raw_ostream &OS, const void *Obj) {
+                 OS << *static_cast<const Token *>(Obj);
+               });
   }
 
   friend raw_ostream &operator<<(raw_ostream &Stream, const Token &Tok) {
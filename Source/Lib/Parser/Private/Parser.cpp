@@ -104,8 +104,9 @@ Program *Parser::parseProgram() {
 
   consumeToken();
 
-  // Parse declarations
-  while (isDeclaration(Tok)) {
+  // Parse declarations. Past the error limit the rest of the input is not
+  // worth parsing, its diagnostics would be dropped anyway.
+  while (isDeclaration(Tok) && !Diags.hasErrorLimitBeenReached()) {
     if (Declaration *D = parseDeclaration()) {
       Declarations.push_back(D);
     } else {
@@ -114,7 +115,7 @@ Program *Parser::parseProgram() {
   }
 
   // Parse statements
-  while (!Tok.is(tok::eof)) {
+  while (!Tok.is(tok::eof) && !Diags.hasErrorLimitBeenReached()) {
     if (Stmt *S = parseStmt()) {
       if (isNotPassStmt(S)) {
         Statements.push_back(S);
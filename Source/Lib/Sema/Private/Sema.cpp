@@ -33,10 +33,11 @@ static raw_ostream &operator<<(raw_ostream &Stream, const Type &T) {
 }
 
 static InFlightDiagnostic &&operator<<(InFlightDiagnostic &&D, const Type &T) {
-  std::string Err;
-  llvm::raw_string_ostream(Err) << T;
-  D << Err;
-  return std::move(D);
+  return std::move(D) << DiagnosticArgument(
+             DiagnosticArgument::ArgKind::Type, &T,
+             [](raw_ostream &OS, const void *Obj) {
+               OS << *static_cast<const Type *>(Obj);
+             });
 }
 
 class Sema::Analysis : public RecursiveASTVisitor<Analysis> {
@@ -77,11 +78,33 @@ public:
     Actions.initializeGlobalScope();
     for (Declaration *D : P->getDeclarations())
       handleDeclaration(D);
-    return Base::traverseProgram(P);
+    Actions.buildMemberTables(P);
+    bool Result = Base::traverseProgram(P);
+    // Drop the class entries added by traverseClassDef, so that the resolver
+    // is clean for the next run.
+    for (Declaration *D : P->getDeclarations())
+      if (isa<ClassDef>(D))
+        Actions.IdResolver.removeDecl(D);
+    return Result;
+  }
+
+  // Stop the traversal once the error limit is reached, anything found
+  // afterwards would not be reported.
+  bool traverseDeclaration(Declaration *D) {
+    if (Diags.hasErrorLimitBeenReached())
+      return false;
+    return Base::traverseDeclaration(D);
+  }
+
+  bool traverseStmt(Stmt *S) {
+    if (Diags.hasErrorLimitBeenReached())
+      return false;
+    return Base::traverseStmt(S);
   }
 
   bool traverseClassDef(ClassDef *C) {
     SemaScope ClassScope(this, Scope::ScopeKind::Class);
+    SaveAndRestore ClassGuard(CurClass, C);
     Actions.IdResolver.addDecl(C);
     if (!Actions.checkSuperClass(C)) {
       return Base::traverseClassDef(C);
@@ -101,6 +124,16 @@ public:
   bool traverseFuncDef(FuncDef *F) {
     Actions.handleFuncDef(F);
     bool RTC = visitClassType(dyn_cast<ClassType>(F->getReturnType()));
+    // Bodies of top-level functions and methods only depend on the global and
+    // class scopes, which are complete at this point.
+    if (Actions.DeferredFuncs && !Actions.getCurScope()->isFunc()) {
+      Actions.deferFuncDef(F, CurClass, RTC);
+      return true;
+    }
+    return traverseFuncBody(F, RTC);
+  }
+
+  bool traverseFuncBody(FuncDef *F, bool RTC) {
     std::shared_ptr<Scope> CS = Actions.GlobalScope;
     if (Actions.getCurScope() != Actions.GlobalScope)
       CS = Actions.getCurScope();
@@ -120,6 +153,8 @@ public:
     }
     ValueType *ERTy = Actions.Ctx.convertAnnotationToVType(F->getReturnType());
     for (Stmt *S : F->getStatements()) {
+      if (Diags.hasErrorLimitBeenReached())
+        return false;
       auto tr = Base::traverseStmt(S);
       if (ReturnStmt::classof(S) && RTC) {
         ReturnStmt *RS = dyn_cast<ReturnStmt>(S);
@@ -283,30 +318,48 @@ private:
 private:
   Sema &Actions;
   DiagnosticsEngine &Diags;
+  ClassDef *CurClass = nullptr;
 };
 
-Sema::Sema(DiagnosticsEngine &Diags, ASTContext &C) : Diags(Diags), Ctx(C) {}
+/// Collects the nodes of a function in traversal order, so that the nodes of
+/// two functions parsed from the same source line up.
+class NodeCollector : public RecursiveASTVisitor<NodeCollector> {
+public:
+  bool visitDeclaration(Declaration *D) {
+    Decls.push_back(D);
+    return true;
+  }
 
-void Sema::initialize() {
-  ClassDef *ObjCD = Ctx.getObjectClass();
-  ClassDef *IntCD = Ctx.getIntClass();
-  ClassDef *StrCD = Ctx.getStrClass();
-  ClassDef *BoolCD = Ctx.getBoolClass();
-  ClassDef *NoneCD = Ctx.getNoneClass();
+  bool visitExpr(Expr *E) {
+    Exprs.push_back(E);
+    return true;
+  }
 
-  FuncDef *PrintFD = Ctx.getPrintFunc();
-  FuncDef *InputFD = Ctx.getInputFunc();
-  FuncDef *LenFD = Ctx.getLenFunc();
+  SmallVector<Declaration *, 0> Decls;
+  SmallVector<Expr *, 0> Exprs;
+};
 
-  IdResolver.addDecl(ObjCD);
-  IdResolver.addDecl(IntCD);
-  IdResolver.addDecl(StrCD);
-  IdResolver.addDecl(BoolCD);
-  IdResolver.addDecl(NoneCD);
+static StringRef getSourceText(const Declaration *D) {
+  const char *Start = D->getLocation().Start.getPointer();
+  const char *End = D->getLocation().End.getPointer();
+  return StringRef(Start, End - Start);
+}
 
-  IdResolver.addDecl(PrintFD);
-  IdResolver.addDecl(InputFD);
-  IdResolver.addDecl(LenFD);
+static Declaration *findByName(Scope *S, StringRef Name) {
+  for (; S; S = S->getParent().get())
+    for (Declaration *D : S->getDecls())
+      if (D->getName() == Name)
+        return D;
+  return nullptr;
+}
+
+Sema::Sema(DiagnosticsEngine &Diags, ASTContext &C) : Diags(Diags), Ctx(C) {}
+
+Sema::Sema(DiagnosticsEngine &Diags, ASTContext &C, const Sema &Parent)
+    : Diags(Diags), Ctx(C), GlobalScope(Parent.GlobalScope),
+      CurScope(Parent.GlobalScope), IdResolver(/*IsDetached=*/true) {
+  for (Declaration *D : GlobalScope->getDecls())
+    IdResolver.addDecl(D);
 }
 
 void Sema::initializeGlobalScope() {
@@ -329,6 +382,11 @@ void Sema::initializeGlobalScope() {
   GlobalScope->addDecl(PrintFD);
   GlobalScope->addDecl(InputFD);
   GlobalScope->addDecl(LenFD);
+
+  // The predefined declarations leave the resolver together with the global
+  // scope, so they are added again on every run.
+  for (Declaration *D : GlobalScope->getDecls())
+    IdResolver.addDecl(D);
 }
 
 void Sema::handleDeclaration(Declaration *D) {
@@ -353,10 +411,246 @@ void Sema::handleFuncDef(FuncDef *F) {
 }
 
 void Sema::run() {
+  if (NumThreads != 1 || Incremental)
+    return runDeferred();
   Analysis V(*this);
   V.traverseAST(Ctx);
 }
 
+void Sema::printStats(raw_ostream &OS) const {
+  IdResolver.printStats(OS);
+  if (!Incremental)
+    return;
+  OS << "*** Incremental Sema Stats:\n";
+  OS << "  " << NumReusedBodies << " function bodies reused\n";
+  OS << "  " << NumCheckedBodies << " function bodies checked\n";
+}
+
+void Sema::runDeferred() {
+  // Check everything but the bodies of top-level functions and methods,
+  // keeping the diagnostics so that the ones of the deferred bodies can be
+  // merged back in source order. The error limit applies to the merged
+  // diagnostics, so that the same ones are reported as by a serial run.
+  StoredDiagnosticConsumer Stored;
+  DiagnosticConsumer *Client = Diags.setClient(&Stored);
+  unsigned ErrorLimit = Diags.getErrorLimit();
+  Diags.setErrorLimit(0);
+  SmallVector<DeferredFunc, 0> Funcs;
+  SerialDiags = &Stored;
+  DeferredFuncs = &Funcs;
+  {
+    Analysis V(*this);
+    V.traverseAST(Ctx);
+  }
+  DeferredFuncs = nullptr;
+  SerialDiags = nullptr;
+  Diags.setErrorLimit(ErrorLimit);
+  Diags.uncount(Stored.getDiagnostics());
+
+  llvm::StringMap<llvm::hash_code> NewInterfaces;
+  if (Incremental)
+    for (Declaration *D : GlobalScope->getDecls())
+      NewInterfaces[D->getName()] = getInterfaceHash(D);
+
+  SmallVector<StoredDiagnosticConsumer, 0> FuncDiags(Funcs.size());
+  SmallVector<BodyRecord, 0> Records(Incremental ? Funcs.size() : 0);
+  SmallVector<std::size_t, 0> ToCheck;
+  // Past the error limit, reached before Sema, the diagnostics of the bodies
+  // would be dropped, so they are not checked at all.
+  bool SkipBodies = Diags.hasErrorLimitBeenReached();
+  NumReusedBodies = 0;
+  for (std::size_t I = 0, E = Funcs.size(); I != E; ++I) {
+    if (Incremental) {
+      Records[I].F = Funcs[I].F;
+      Records[I].SourceHash = llvm::hash_combine(getSourceText(Funcs[I].F));
+      if (reuseBody(Funcs[I], Records[I], NewInterfaces, FuncDiags[I])) {
+        ++NumReusedBodies;
+        continue;
+      }
+      Records[I].Reusable = !SkipBodies;
+    }
+    if (!SkipBodies)
+      ToCheck.push_back(I);
+  }
+  NumCheckedBodies = ToCheck.size();
+
+  {
+    llvm::DefaultThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+    std::atomic<std::size_t> NextFunc = 0;
+    std::size_t NumWorkers =
+        std::min<std::size_t>(Pool.getMaxConcurrency(), ToCheck.size());
+    for (std::size_t I = 0; I != NumWorkers; ++I)
+      Pool.async([&] {
+        DiagnosticsEngine WorkerDiags(nullptr);
+        Sema Worker(WorkerDiags, Ctx, *this);
+        for (std::size_t N; (N = NextFunc++) < ToCheck.size();) {
+          std::size_t J = ToCheck[N];
+          WorkerDiags.setClient(&FuncDiags[J]);
+          Worker.CurRecord = Incremental ? &Records[J] : nullptr;
+          Worker.checkDeferredFunc(Funcs[J]);
+        }
+      });
+    Pool.wait();
+  }
+
+  if (Incremental) {
+    for (std::size_t J : ToCheck) {
+      BodyRecord &R = Records[J];
+      const char *Start = R.F->getLocation().Start.getPointer();
+      const char *End = R.F->getLocation().End.getPointer();
+      for (const Diagnostic &D : FuncDiags[J].getDiagnostics()) {
+        const char *Loc = D.getLocation().getPointer();
+        R.Reusable &= Loc >= Start && Loc <= End;
+        R.Diags.emplace_back(Loc - Start, D);
+      }
+    }
+    Bodies.clear();
+    for (std::size_t I = 0, E = Funcs.size(); I != E; ++I) {
+      auto [It, Inserted] =
+          Bodies.try_emplace(getBodyKey(Funcs[I]), std::move(Records[I]));
+      // Bodies with the same key can not be told apart in the next run.
+      if (!Inserted)
+        It->second.Reusable = false;
+    }
+    Interfaces = std::move(NewInterfaces);
+  }
+
+  Diags.setClient(Client);
+  ArrayRef<Diagnostic> Serial = Stored.getDiagnostics();
+  std::size_t Pos = 0;
+  for (std::size_t I = 0, E = Funcs.size(); I != E; ++I) {
+    for (; Pos != Funcs[I].DiagPos; ++Pos)
+      Diags.forward(Serial[Pos]);
+    for (const Diagnostic &D : FuncDiags[I].getDiagnostics())
+      Diags.forward(D);
+  }
+  for (; Pos != Serial.size(); ++Pos)
+    Diags.forward(Serial[Pos]);
+}
+
+void Sema::deferFuncDef(FuncDef *F, ClassDef *Class, bool CheckReturn) {
+  DeferredFuncs->push_back(
+      {F, Class, CurScope, CheckReturn, SerialDiags->size()});
+}
+
+void Sema::checkDeferredFunc(const DeferredFunc &DF) {
+  // Sibling members are visible in the body of a method.
+  if (DF.Class)
+    noteDependency(DF.Class->getName());
+
+  CurScope = DF.Parent;
+  if (CurScope != GlobalScope)
+    for (Declaration *D : CurScope->getDecls())
+      IdResolver.addDecl(D);
+
+  Analysis V(*this);
+  V.traverseFuncBody(DF.F, DF.CheckReturn);
+
+  if (CurScope != GlobalScope)
+    actOnPopScope(CurScope.get());
+  CurScope = GlobalScope;
+}
+
+std::string Sema::getBodyKey(const DeferredFunc &DF) {
+  if (DF.Class)
+    return (DF.Class->getName() + "." + DF.F->getName()).str();
+  return DF.F->getName().str();
+}
+
+llvm::hash_code Sema::getInterfaceHash(Declaration *D) {
+  auto getVType = [this](TypeAnnotation *TA) -> ValueType * {
+    return TA ? Ctx.convertAnnotationToVType(TA) : nullptr;
+  };
+
+  return llvm::TypeSwitch<Declaration *, llvm::hash_code>(D)
+      .Case([](VarDef *V) {
+        return llvm::hash_combine(V->getKind(), getSourceText(V));
+      })
+      .Case([&getVType](FuncDef *F) {
+        llvm::hash_code H =
+            llvm::hash_combine(F->getKind(), getVType(F->getReturnType()));
+        for (ParamDecl *P : F->getParams())
+          H = llvm::hash_combine(H, P->getName(), getVType(P->getType()));
+        return H;
+      })
+      .Case([this](ClassDef *C) {
+        Identifier *Super = C->getSuperClass();
+        llvm::hash_code H = llvm::hash_combine(
+            C->getKind(), Super ? Super->getName() : StringRef());
+        // The member table also covers the inherited members.
+        const ClassMemberTable *T = Ctx.getMemberTable(C);
+        if (!T)
+          return H;
+        for (ArrayRef<ClassMemberTable::Member> Members :
+             {T->attributes(), T->methods()})
+          for (const ClassMemberTable::Member &M : Members)
+            H = llvm::hash_combine(H, M.Decl->getName(), M.Owner->getName(),
+                                   getInterfaceHash(M.Decl));
+        return H;
+      })
+      .Default([](Declaration *D) { return llvm::hash_combine(D->getKind()); });
+}
+
+bool Sema::reuseBody(const DeferredFunc &DF, BodyRecord &Record,
+                     const llvm::StringMap<llvm::hash_code> &NewInterfaces,
+                     DiagnosticConsumer &Consumer) {
+  auto It = Bodies.find(getBodyKey(DF));
+  if (It == Bodies.end())
+    return false;
+
+  BodyRecord &Old = It->second;
+  if (!Old.Reusable || Old.SourceHash != Record.SourceHash)
+    return false;
+  for (StringRef Dep : Old.Deps.keys())
+    if (Interfaces.lookup(Dep) != NewInterfaces.lookup(Dep))
+      return false;
+
+  transferAnnotations(DF, Old.F);
+  const char *Start = DF.F->getLocation().Start.getPointer();
+  for (const auto &[Offset, D] : Old.Diags)
+    Consumer.handleDiagnostic(Diagnostic(
+        D.getKind(), SMLoc::getFromPointer(Start + Offset), D.getMessage()));
+
+  Record = std::move(Old);
+  Record.F = DF.F;
+  Bodies.erase(It);
+  return true;
+}
+
+void Sema::transferAnnotations(const DeferredFunc &DF, FuncDef *From) {
+  NodeCollector Old, New;
+  Old.traverseFuncDef(From);
+  New.traverseFuncDef(DF.F);
+
+  llvm::DenseMap<Declaration *, Declaration *> DeclMap;
+  for (auto [O, N] : llvm::zip_equal(Old.Decls, New.Decls))
+    DeclMap[O] = N;
+
+  for (auto [O, N] : llvm::zip_equal(Old.Exprs, New.Exprs)) {
+    N->setInferredType(O->getInferredType());
+    auto *OldRef = dyn_cast<DeclRef>(O);
+    if (!OldRef || !OldRef->getDeclInfo())
+      continue;
+    // Declarations outside of the body belong to the enclosing class or to
+    // the global scope, and are found by name in the new program.
+    Declaration *D = OldRef->getDeclInfo();
+    Declaration *NewD = DeclMap.lookup(D);
+    if (!NewD)
+      NewD = findByName(DF.Parent.get(), D->getName());
+    cast<DeclRef>(N)->setDeclInfo(NewD);
+  }
+}
+
+void Sema::noteDependency(StringRef Name) {
+  if (CurRecord)
+    CurRecord->Deps.insert(Name);
+}
+
+IdentifierResolver::iterator Sema::resolve(SymbolInfo *SI) {
+  noteDependency(SI->getName());
+  return IdResolver.begin(SI);
+}
+
 void Sema::actOnPopScope(Scope *S) {
   auto Decls = S->getDecls();
   for (Declaration *D : Decls)
@@ -502,7 +796,7 @@ bool Sema::checkParams(SMRange point, ArrayRef<ParamDecl *> Indecs,
   }
   if (Decls.size() != Args.size()) {
     Diags.emitError(point.Start, diag::err_num_arguments)
-        << std::to_string(Decls.size()) << std::to_string(Args.size());
+        << static_cast<int>(Decls.size()) << static_cast<int>(Args.size());
     return false;
   }
   for (auto i = 0; i < Args.size(); ++i) {
@@ -526,6 +820,9 @@ bool Sema::checkCallExpr(CallExpr *C) {
           << dyn_cast<DeclRef>(C->getFunction())->getName();
       return false;
     }
+    // Analyses tell calls of functions and classes from reads of variables
+    // by the declaration of the callee.
+    cast<DeclRef>(C->getFunction())->setDeclInfo(FD);
   }
   if (FuncDef *F = dyn_cast<FuncDef>(FD)) {
     ArrayRef<ParamDecl *> decLn = F->getParams();
@@ -539,7 +836,7 @@ bool Sema::checkCallExpr(CallExpr *C) {
 }
 
 bool Sema::checkMethodCallExpr(MethodCallExpr *Method) {
-  IdentifierResolver::iterator It = IdResolver.begin(
+  IdentifierResolver::iterator It = resolve(
       dyn_cast<DeclRef>(Method->getMethod()->getObject())->getSymbolInfo());
   if (VarDef *V = dyn_cast<VarDef>(*It)) {
     if (Declaration *D =
@@ -621,7 +918,7 @@ bool Sema::checkAssignTarget(Expr *E) {
     return false;
   }
   if (DeclRef *DR = dyn_cast<DeclRef>(E)) {
-    auto It = IdResolver.begin(DR->getSymbolInfo());
+    auto It = resolve(DR->getSymbolInfo());
     if (It == IdResolver.end() || !CurScope->isDeclInScope(*It)) {
       Diags.emitError(DR->getLocation().Start, diag::err_bad_local_assign)
           << DR->getName();
@@ -663,27 +960,26 @@ bool Sema::checkIndexExpr(IndexExpr *E) {
 }
 
 bool Sema::checkClassDeclaration(ClassDef *C, Declaration *D) {
-  for (Declaration *SD : C->getDeclarations()) {
-    if (SD->getName() == D->getName() && D->getName() != "__init__") {
-      if (FuncDef::classof(SD) && FuncDef::classof(D)) {
-        FuncDef *OF = dyn_cast<FuncDef>(SD);
-        FuncDef *NF = dyn_cast<FuncDef>(D);
-        return checkMethodOverride(OF, NF);
-      } else {
-        Diags.emitError(D->getLocation().Start, diag::err_redefine_attr)
-            << D->getName();
-        return false;
-      }
-    }
-  }
-  return true;
+  if (D->getName() == "__init__")
+    return true;
+  // The member may be inherited from any class up the chain.
+  const ClassMemberTable *T = Ctx.getMemberTable(C);
+  const ClassMemberTable::Member *Mem =
+      T ? T->lookup(D->getSymbolInfo()) : nullptr;
+  if (!Mem)
+    return true;
+  if (auto *OF = dyn_cast<FuncDef>(Mem->Decl); OF && isa<FuncDef>(D))
+    return checkMethodOverride(OF, cast<FuncDef>(D));
+  Diags.emitError(D->getLocation().Start, diag::err_redefine_attr)
+      << D->getName();
+  return false;
 }
 
 bool Sema::checkMemberExpr(MemberExpr *ME, bool IsMethod) {
   Expr *O = ME->getObject();
   DeclRef *M = ME->getMember();
   if (DeclRef *D = dyn_cast<DeclRef>(O)) {
-    IdentifierResolver::iterator It = IdResolver.begin(D->getSymbolInfo());
+    IdentifierResolver::iterator It = resolve(D->getSymbolInfo());
     if (ParamDecl *P = dyn_cast<ParamDecl>(*It)) {
       Declaration *D =
           lookupClass(GlobalScope.get(), dyn_cast<ClassType>(P->getType()));
@@ -754,26 +1050,42 @@ bool Sema::checkInitDeclaration(ClassDef *C, FuncDef *FD) {
   return true;
 }
 
-Declaration *Sema::findDeclaration(ClassDef *C, DeclRef *M) {
-  for (Declaration *D : C->getDeclarations()) {
-    if (D->getName() == M->getName())
-      return D;
+void Sema::buildMemberTables(Program *P) {
+  const ClassMemberTable &ObjTable =
+      Ctx.createMemberTable(Ctx.getObjectClass(), nullptr);
+  for (ClassDef *C : {Ctx.getIntClass(), Ctx.getStrClass(), Ctx.getBoolClass(),
+                      Ctx.getNoneClass(), Ctx.getEmptyClass()})
+    Ctx.createMemberTable(C, &ObjTable);
+
+  // A superclass has to be defined before its subclasses, anything else was
+  // diagnosed by checkSuperClass and falls back to object.
+  for (Declaration *D : P->getDeclarations()) {
+    if (ClassDef *C = dyn_cast<ClassDef>(D)) {
+      const ClassMemberTable *Super = nullptr;
+      if (ClassDef *SC = getSuperClass(C))
+        Super = Ctx.getMemberTable(SC);
+      Ctx.createMemberTable(C, Super ? Super : &ObjTable);
+    }
   }
-  if (ClassDef *SC = getSuperClass(C))
-    return findDeclaration(SC, M);
-  else
+}
+
+Declaration *Sema::findDeclaration(ClassDef *C, DeclRef *M) {
+  const ClassMemberTable *T = Ctx.getMemberTable(C);
+  if (!T)
     return nullptr;
+  // The member may be declared by any class up the chain.
+  noteDependency(C->getName());
+  if (const ClassMemberTable::Member *Mem = T->lookup(M->getSymbolInfo()))
+    return Mem->Decl;
+  return nullptr;
 }
 
 FuncDef *Sema::getInitFunc(ClassDef *C) {
-  for (Declaration *D : C->getDeclarations()) {
-    if (D->getName() == "__init__" && FuncDef::classof(D))
-      return dyn_cast<FuncDef>(D);
-  }
-  if (ClassDef *SC = getSuperClass(C))
-    return getInitFunc(SC);
-  else
+  const ClassMemberTable *T = Ctx.getMemberTable(C);
+  if (!T)
     return nullptr;
+  const ClassMemberTable::Member *Mem = T->lookup(Ctx.getInitSymbol());
+  return Mem ? dyn_cast<FuncDef>(Mem->Decl) : nullptr;
 }
 
 bool Sema::checkUnaryExpr(UnaryExpr *UE) {
@@ -956,7 +1268,7 @@ void Sema::actOnBinaryExpr(BinaryExpr *B) {
 
 void Sema::checkClassShadow(Declaration *ID) {
   SymbolInfo *SI = ID->getSymbolInfo();
-  IdentifierResolver::iterator I = IdResolver.begin(SI);
+  IdentifierResolver::iterator I = resolve(SI);
   IdentifierResolver::iterator E = IdResolver.end();
   Declaration *D = nullptr;
   for (; !D && I != E; ++I) {
@@ -1006,7 +1318,7 @@ ClassDef *Sema::getSuperClass(ClassDef *CD) {
   if (CD == Ctx.getObjectClass())
     return nullptr;
   SymbolInfo *CS = CD->getSuperClass()->getSymbolInfo();
-  IdentifierResolver::iterator It = IdResolver.begin(CS);
+  IdentifierResolver::iterator It = resolve(CS);
   if (It != IdResolver.end()) {
     return dyn_cast<ClassDef>(*It);
   }
@@ -1014,6 +1326,8 @@ ClassDef *Sema::getSuperClass(ClassDef *CD) {
 }
 
 Declaration *Sema::lookupClass(Scope *S, ClassType *CT) {
+  if (S == GlobalScope.get())
+    noteDependency(CT->getClassName());
   auto Decls = S->getDecls();
   auto It = llvm::find_if(Decls, [CT](Declaration *D) {
     return D->getName() == CT->getClassName();
@@ -1024,6 +1338,8 @@ Declaration *Sema::lookupClass(Scope *S, ClassType *CT) {
 }
 
 Declaration *Sema::lookupName(Scope *S, SymbolInfo *SI) {
+  if (S == GlobalScope.get())
+    noteDependency(SI->getName());
   auto Decls = S->getDecls();
   auto It = llvm::find_if(
       Decls, [SI](Declaration *D) { return D->getSymbolInfo() == SI; });
@@ -1034,7 +1350,7 @@ Declaration *Sema::lookupName(Scope *S, SymbolInfo *SI) {
 
 Declaration *Sema::lookupDecl(DeclRef *DR) {
   SymbolInfo *SI = DR->getSymbolInfo();
-  IdentifierResolver::iterator I = IdResolver.begin(SI);
+  IdentifierResolver::iterator I = resolve(SI);
   IdentifierResolver::iterator E = IdResolver.end();
 
   Declaration *D = nullptr;
@@ -8,22 +8,11 @@ import std;
 export namespace chocopy {
 
 class IdentifierResolver {
-  class IdDeclInfo {
-  public:
-    using DeclsTy = SmallVector<Declaration *, 2>;
-
-    DeclsTy::iterator decls_begin() { return Decls.begin(); }
-
-    DeclsTy::iterator decls_end() { return Decls.end(); }
-
-    void addDecl(Declaration *D) { Decls.push_back(D); }
-    void removeDecl(Declaration *D);
-
-    std::size_t size() { return Decls.size(); }
-    void dump(ASTContext &Ctx);
-
-  private:
-    DeclsTy Decls;
+  /// A link of the chain of declarations visible under one name, the most
+  /// recent one first. Unlinked nodes are kept in a free list and recycled.
+  struct ShadowNode {
+    Declaration *D;
+    ShadowNode *Next;
   };
 
 public:
@@ -37,57 +26,34 @@ public:
     using iterator_category = std::input_iterator_tag;
     using difference_type = std::ptrdiff_t;
 
-    /// Ptr - There are 2 forms that 'Ptr' represents:
-    /// 1) A single Declaration. (Ptr & 0x1 == 0)
-    /// 2) A IdDeclInfo::DeclsTy::iterator that traverses only the decls of the
-    ///    same declaration context. (Ptr & 0x1 == 0x1)
-    std::uintptr_t Ptr = 0;
-    using BaseIter = IdDeclInfo::DeclsTy::iterator;
-
-    /// A single Declaration. (Ptr & 0x1 == 0)
-    iterator(Declaration *D) {
-      Ptr = reinterpret_cast<std::uintptr_t>(D);
-      assert((Ptr & 0x1) == 0 && "Invalid Ptr!");
-    }
-
-    /// A IdDeclInfo::DeclsTy::iterator that walks or not the parent declaration
-    /// contexts depending on 'LookInParentCtx'.
-    iterator(BaseIter I) { Ptr = reinterpret_cast<std::uintptr_t>(I) | 0x1; }
-
-    bool isIterator() const { return (Ptr & 0x1); }
-
-    BaseIter getIterator() const {
-      assert(isIterator() && "Ptr not an iterator!");
-      return reinterpret_cast<BaseIter>(Ptr & ~0x1);
-    }
+  private:
+    iterator(ShadowNode *N) : Node(N) {}
 
-    void incrementSlowCase();
+    ShadowNode *Node = nullptr;
 
   public:
     iterator() = default;
 
     Declaration *operator*() const {
-      if (isIterator())
-        return *getIterator();
-      else
-        return reinterpret_cast<Declaration *>(Ptr);
+      assert(Node && "Dereferencing end iterator!");
+      return Node->D;
     }
 
-    bool operator==(const iterator &RHS) const { return Ptr == RHS.Ptr; }
-    bool operator!=(const iterator &RHS) const { return Ptr != RHS.Ptr; }
+    bool operator==(const iterator &RHS) const { return Node == RHS.Node; }
+    bool operator!=(const iterator &RHS) const { return Node != RHS.Node; }
 
     // Preincrement.
     iterator &operator++() {
-      if (!isIterator()) // common case.
-        Ptr = 0;
-      else
-        incrementSlowCase();
+      Node = Node->Next;
       return *this;
     }
   };
 
 public:
-  IdentifierResolver();
+  /// A detached resolver keeps its declaration chains in a private map
+  /// instead of SymbolInfo::FETokenInfo, so that several resolvers can be
+  /// used concurrently over the same symbol table.
+  explicit IdentifierResolver(bool IsDetached = false);
   IdentifierResolver(IdentifierResolver &&) = delete;
   IdentifierResolver(const IdentifierResolver &) = delete;
   IdentifierResolver &operator=(const IdentifierResolver &) = delete;
@@ -97,24 +63,45 @@ public:
   void addDecl(Declaration *D);
   void removeDecl(Declaration *D);
 
-  iterator begin(SymbolInfo *Name);
+  iterator begin(SymbolInfo *Name) { return iterator(getChain(Name)); }
   iterator end() { return iterator(); }
 
+  /// Number of declarations added, each of which takes a chain node.
+  unsigned getNumAddedDecls() const { return NumAdded; }
+  /// Number of chain nodes taken from the allocator. Nodes are recycled, so
+  /// this never exceeds the peak number of live nodes.
+  unsigned getNumAllocatedNodes() const { return NumAllocated; }
+  unsigned getPeakLiveNodes() const { return PeakLive; }
+  void printStats(raw_ostream &OS) const;
+
 private:
-  /// FETokenInfo contains a Declaration pointer if lower bit == 0.
-  static inline bool isDeclarationPtr(void *Ptr) {
-    return (reinterpret_cast<std::uintptr_t>(Ptr) & 0x1) == 0;
+  ShadowNode *getChain(SymbolInfo *SI) const {
+    if (IsDetached)
+      return Chains.lookup(SI);
+    return static_cast<ShadowNode *>(SI->getFETokenInfo());
   }
 
-  static inline IdDeclInfo *toIdDeclInfo(void *Ptr) {
-    assert((reinterpret_cast<std::uintptr_t>(Ptr) & 0x1) == 1 &&
-           "Ptr not a IdDeclInfo* !");
-    return reinterpret_cast<IdDeclInfo *>(
-        reinterpret_cast<std::uintptr_t>(Ptr) & ~0x1);
+  void setChain(SymbolInfo *SI, ShadowNode *N) {
+    if (!IsDetached)
+      SI->setFETokenInfo(N);
+    else if (N)
+      Chains[SI] = N;
+    else
+      Chains.erase(SI);
   }
 
+  ShadowNode *createNode(Declaration *D, ShadowNode *Next);
+  void releaseNode(ShadowNode *N);
+
 private:
-  class IdDeclInfoMap;
-  std::unique_ptr<IdDeclInfoMap> IdDeclInfos;
+  bool IsDetached;
+  llvm::DenseMap<SymbolInfo *, ShadowNode *> Chains;
+
+  llvm::BumpPtrAllocator Allocator;
+  ShadowNode *FreeList = nullptr;
+  unsigned NumAdded = 0;
+  unsigned NumAllocated = 0;
+  unsigned NumLive = 0;
+  unsigned PeakLive = 0;
 };
 } // namespace chocopy
@@ -3,6 +3,7 @@ import AST;
 import Basic;
 export import :IdentifierResolver;
 export import :Scope;
+import std;
 
 export namespace chocopy {
 
@@ -12,15 +13,74 @@ class Sema {
 public:
   Sema(DiagnosticsEngine &Diags, ASTContext &C);
 
-  void initialize();
   void initializeGlobalScope();
 
 public:
   DiagnosticsEngine &getDiagnosticEngine() const { return Diags; }
 
+  /// Number of threads used to check the bodies of top-level functions and
+  /// methods. 1 checks everything on the calling thread, 0 uses all hardware
+  /// threads.
+  void setNumThreads(unsigned N) { NumThreads = N; }
+  unsigned getNumThreads() const { return NumThreads; }
+
+  /// In incremental mode Sema remembers, for each top-level function and
+  /// method body, the global names it depended on. A later run over a
+  /// re-parsed program in the same ASTContext only re-checks the bodies whose
+  /// source or dependencies changed, and copies the annotations and
+  /// diagnostics of the others from the previous program.
+  void setIncremental(bool V) { Incremental = V; }
+  bool isIncremental() const { return Incremental; }
+
   void run();
 
+  void printStats(raw_ostream &OS) const;
+
 private:
+  /// A function body whose checking was postponed by the deferred driver.
+  struct DeferredFunc {
+    FuncDef *F;
+    /// Class declaring the function if it is a method.
+    ClassDef *Class;
+    /// Scope enclosing the function: the global scope or a class scope.
+    std::shared_ptr<Scope> Parent;
+    /// Whether the return type annotation names a valid class.
+    bool CheckReturn;
+    /// Number of diagnostics emitted before the body would have been checked.
+    std::size_t DiagPos;
+  };
+
+  /// Creates a worker that checks deferred bodies of \p Parent. The worker
+  /// has its own detached identifier resolver seeded with the global decls.
+  Sema(DiagnosticsEngine &Diags, ASTContext &C, const Sema &Parent);
+
+  /// What was learned while checking a deferred body, kept between
+  /// incremental runs.
+  struct BodyRecord {
+    FuncDef *F = nullptr;
+    llvm::hash_code SourceHash = 0;
+    /// Names looked up while checking the body.
+    llvm::StringSet<> Deps;
+    /// Diagnostics of the body with their offset from the start of F.
+    SmallVector<std::pair<std::ptrdiff_t, Diagnostic>, 0> Diags;
+    /// False if the record can not be reused, e.g. because one of the
+    /// diagnostics points outside of the body.
+    bool Reusable = true;
+  };
+
+  void runDeferred();
+  void deferFuncDef(FuncDef *F, ClassDef *Class, bool CheckReturn);
+  void checkDeferredFunc(const DeferredFunc &DF);
+
+  static std::string getBodyKey(const DeferredFunc &DF);
+  llvm::hash_code getInterfaceHash(Declaration *D);
+  bool reuseBody(const DeferredFunc &DF, BodyRecord &Record,
+                 const llvm::StringMap<llvm::hash_code> &NewInterfaces,
+                 DiagnosticConsumer &Consumer);
+  void transferAnnotations(const DeferredFunc &DF, FuncDef *From);
+  void noteDependency(StringRef Name);
+  IdentifierResolver::iterator resolve(SymbolInfo *SI);
+
   std::shared_ptr<Scope> getGlobalScope() const { return GlobalScope; }
   void setGlobalScope(std::shared_ptr<Scope> S) { GlobalScope = std::move(S); }
 
@@ -72,6 +132,7 @@ private:
   bool checkIndexExpr(IndexExpr *E);
   bool checkInitDeclaration(ClassDef *C, FuncDef *FD);
   bool checkMemberExpr(MemberExpr *ME, bool IsMethod);
+  void buildMemberTables(Program *P);
   Declaration *findDeclaration(ClassDef *C, DeclRef *M);
   FuncDef *getInitFunc(ClassDef *C);
   bool checkUnaryExpr(UnaryExpr *UE);
@@ -88,5 +149,19 @@ private:
   std::shared_ptr<Scope> GlobalScope;
   std::shared_ptr<Scope> CurScope;
   IdentifierResolver IdResolver;
+  unsigned NumThreads = 1;
+  SmallVectorImpl<DeferredFunc> *DeferredFuncs = nullptr;
+  StoredDiagnosticConsumer *SerialDiags = nullptr;
+
+  bool Incremental = false;
+  /// Record of the body being checked, if dependencies are tracked.
+  BodyRecord *CurRecord = nullptr;
+  /// Bodies of the previous incremental run, by getBodyKey().
+  llvm::StringMap<BodyRecord> Bodies;
+  /// Interface hashes of the global declarations of the previous run.
+  llvm::StringMap<llvm::hash_code> Interfaces;
+  /// Deferred bodies of the last incremental run, reused or checked again.
+  unsigned NumReusedBodies = 0;
+  unsigned NumCheckedBodies = 0;
 };
 } // namespace chocopy
@@ -0,0 +1,106 @@
+/* The runtime an executable built with -fruntime links with. It provides
+ * main, which calls the Main of the program, and the functions and
+ * prototypes the generated code refers to, laid out as CodeGenModule
+ * declares them. The JIT of -run resolves the same names against a copy of
+ * this runtime built into the compiler.
+ *
+ *   chocopy-llvm -fruntime=Source/Runtime/Runtime.c -o prog prog.py
+ *
+ * The names are not C identifiers, so they are given as assembler labels. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A packed header { i32 tag, i32 size in bytes, ptr dispatch table }
+ * followed by the attributes. */
+struct __attribute__((packed)) ObjectHeader {
+  int32_t Tag;
+  int32_t Size;
+  void *DispatchTable;
+};
+
+struct __attribute__((packed)) IntObject {
+  struct ObjectHeader Header;
+  int32_t Value;
+};
+
+struct __attribute__((packed)) BoolObject {
+  struct ObjectHeader Header;
+  bool Value;
+};
+
+/* The characters follow the length, with a terminating null. */
+struct __attribute__((packed)) StrObject {
+  struct ObjectHeader Header;
+  int32_t Length;
+  char Data[1];
+};
+
+/* Assembler labels do not get the leading underscore of Mach-O symbols. */
+#ifdef __APPLE__
+#define SYMBOL(Name) __asm__("_" Name)
+#else
+#define SYMBOL(Name) __asm__(Name)
+#endif
+
+enum ClassTag { IntTag = 1, BoolTag = 2, StrTag = 3 };
+
+struct IntObject IntPrototype SYMBOL("$int.class.prototype") = {
+    {IntTag, sizeof(struct IntObject), NULL}, 0};
+struct BoolObject BoolPrototype SYMBOL("$bool.class.prototype") = {
+    {BoolTag, sizeof(struct BoolObject), NULL}, false};
+struct StrObject StrPrototype SYMBOL("$str.class.prototype") = {
+    {StrTag, sizeof(struct StrObject), NULL}, 0, {0}};
+
+void *allocObject(const struct ObjectHeader *Prototype) SYMBOL("$alloc");
+void printObject(const struct ObjectHeader *O) SYMBOL("$print");
+void abortProgram(const struct StrObject *Message) SYMBOL("$abort");
+void Main(void);
+
+void *allocObject(const struct ObjectHeader *Prototype) {
+  void *O = malloc(Prototype->Size);
+  if (!O) {
+    fputs("out of memory\n", stderr);
+    exit(1);
+  }
+  memcpy(O, Prototype, Prototype->Size);
+  return O;
+}
+
+void printObject(const struct ObjectHeader *O) {
+  switch (O ? O->Tag : 0) {
+  case IntTag:
+    printf("%d\n", (int)((const struct IntObject *)O)->Value);
+    break;
+  case BoolTag:
+    puts(((const struct BoolObject *)O)->Value ? "True" : "False");
+    break;
+  case StrTag: {
+    const struct StrObject *S = (const struct StrObject *)O;
+    fwrite(S->Data, 1, S->Length, stdout);
+    putchar('\n');
+    break;
+  }
+  default:
+    fflush(stdout);
+    fputs("Invalid argument to print\n", stderr);
+    exit(1);
+  }
+}
+
+void abortProgram(const struct StrObject *Message) {
+  fflush(stdout);
+  if (Message) {
+    fwrite(Message->Data, 1, Message->Length, stderr);
+    fputc('\n', stderr);
+  }
+  exit(1);
+}
+
+int main(void) {
+  Main();
+  return 0;
+}
@@ -0,0 +1,30 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+class Box(object):
+    v:int = 0
+
+keep:Box = None
+
+def consume(x:[int]) -> int:
+    return len(x)
+
+def allocate(n:int) -> Box:
+    global keep
+    a:Box = None
+    b:[int] = None
+    c:Box = None
+    l:[int] = None
+    t:[int] = None
+    i:int = 0
+    a = Box()
+    print(len([1, 2]))
+    b = [n] + [n]
+    keep = Box()
+    i = consume([i])
+    while i < n:
+        l = [i]
+        t = [i]
+        i = i + len(t)
+    print(len(l) + len(b) + a.v)
+    c = Box()
+    return c
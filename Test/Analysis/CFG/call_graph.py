@@ -0,0 +1,35 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+class Shape(object):
+    def area(self:"Shape") -> int:
+        return 0
+
+class Square(Shape):
+    side:int = 2
+
+    def area(self:"Square") -> int:
+        return self.side * self.side
+
+def even(n:int) -> bool:
+    if n == 0:
+        return True
+    return odd(n - 1)
+
+def odd(n:int) -> bool:
+    if n == 0:
+        return False
+    return even(n - 1)
+
+def total(s:Shape) -> int:
+    def twice() -> int:
+        return s.area() + s.area()
+    return twice()
+
+def fact(n:int) -> int:
+    if n <= 1:
+        return 1
+    return n * fact(n - 1)
+
+print(even(4))
+print(total(Square()))
+print(fact(3))
@@ -0,0 +1,15 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+class C(object):
+    pass
+
+def ident(x:int) -> int:
+    return x
+
+def show(y:int) -> object:
+    c:C = None
+    c = C()
+    print(ident(y))
+    return c
+
+# RUN: %chocopy-llvm -cfg-dump %s 2>&1 | FileCheck %s.err
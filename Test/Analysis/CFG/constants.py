@@ -0,0 +1,24 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+g:int = 1
+h:int = 7
+k:int = 0
+
+def fold() -> int:
+    a:int = 3
+    b:int = 0
+    b = a * 2
+    if b > 10:
+        return 1
+    return b
+
+def clobber() -> int:
+    global g
+    g = 5
+    return 0
+
+k = g + 1
+clobber()
+k = g + h
+if k > 100:
+    print(k)
@@ -0,0 +1,9 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+def count(n:int) -> int:
+    i:int = 0
+    s:int = 0
+    while i < n:
+        s = s + i
+        i = i + 1
+    return s
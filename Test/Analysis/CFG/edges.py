@@ -0,0 +1,9 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+def pick(b:bool) -> int:
+    x:int = 0
+    if b:
+        x = 1
+    else:
+        x = 2
+    return x
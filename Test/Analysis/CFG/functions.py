@@ -0,0 +1,17 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+class Counter(object):
+    n:int = 0
+
+    def bump(self:"Counter") -> int:
+        self.n = self.n + 1
+        return self.n
+
+def outer(x:int) -> int:
+    def inner(y:int) -> int:
+        return y + x
+    return inner(1)
+
+c:Counter = None
+c = Counter()
+print(outer(c.bump()))
@@ -0,0 +1,18 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump %s 2>&1 | FileCheck %s.err
+
+def nest(n:int) -> int:
+    i:int = 0
+    j:int = 0
+    t:int = 0
+    while i < n:
+        j = 0
+        while j < i:
+            t = t + j
+            j = j + 1
+        i = i + 1
+    return t
+
+def flat(x:int) -> int:
+    if x > 0:
+        return x
+    return 0 - x
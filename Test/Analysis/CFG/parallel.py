@@ -0,0 +1,22 @@
+# RUN: %chocopy-llvm --run-sema -cfg-dump -fcfg-threads=1 %s 2>&1 | FileCheck %s.err
+# RUN: %chocopy-llvm --run-sema -cfg-dump -fcfg-threads=4 %s 2>&1 | FileCheck %s.err
+
+def a(x:int) -> int:
+    return x + 1
+
+def b(x:int) -> int:
+    while x > 0:
+        x = x - 1
+    return x
+
+def c(x:int) -> int:
+    def d(y:int) -> int:
+        return y * 2
+    return d(x)
+
+def e(x:bool) -> int:
+    if x:
+        return 1
+    return 0
+
+print(a(1) + b(2) + c(3) + e(True))
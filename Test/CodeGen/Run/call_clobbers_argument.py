@@ -0,0 +1,21 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+class C(object):
+    def second(self: "C", a: int, b: int) -> int:
+        return b
+
+x:int = 1
+c:C = None
+
+def f() -> int:
+    global x
+    x = x + 1
+    return 0
+
+def second(a: int, b: int) -> int:
+    return b
+
+# x is read after f() wrote it.
+c = C()
+print(second(f(), x))
+print(c.second(f(), x))
@@ -0,0 +1,19 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+m:int = 0
+
+def div(a: int, b: int) -> int:
+    return a // b
+
+def mod(a: int, b: int) -> int:
+    return a % b
+
+# The smallest int divided by -1 wraps around to itself.
+m = -2147483647 - 1
+print(div(m, -1))
+print(mod(m, -1))
+print(div(7, -1))
+print(mod(-7, -1))
+print(div(-7, 2))
+print(mod(-7, 2))
+print(m // -1)
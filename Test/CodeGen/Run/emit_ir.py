@@ -0,0 +1,10 @@
+# RUN: %chocopy-llvm -emit-llvm %s | FileCheck %s.ll
+# RUN: %chocopy-llvm -emit-llvm -o %t.ll %s
+# RUN: FileCheck %s.ll --input-file=%t.ll
+# RUN: %chocopy-llvm -emit-bc -o %t.bc %s
+# RUN: llvm-dis %t.bc -o - | FileCheck %s.ll
+
+def twice(x: int) -> int:
+    return x + x
+
+print(twice(21))
@@ -0,0 +1,4 @@
+CHECK: define void @Main()
+CHECK: call fastcc i32 @"$twice"(i32
+CHECK: define internal fastcc i32 @"$twice"(i32 %x)
+CHECK: add i32 %x, %x
@@ -0,0 +1,30 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+class Box(object):
+    v:int = 0
+
+def sum_to(n: int) -> int:
+    b:Box = None
+    s:int = 0
+    k:int = 2
+    i:int = 0
+    # b does not outlive an iteration, k * 3 is folded, the first store to s
+    # is never read.
+    s = 7
+    s = 0
+    while i < n:
+        b = Box()
+        b.v = i * (k * 3)
+        s = s + b.v
+        i = i + 1
+    return s
+
+def keep(n: int) -> Box:
+    b:Box = None
+    b = Box()
+    b.v = n
+    return b
+
+print(sum_to(4))
+print(sum_to(0))
+print(keep(5).v + keep(6).v)
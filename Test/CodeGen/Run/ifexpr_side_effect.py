@@ -0,0 +1,8 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+def f() -> bool:
+    print(2)
+    return True
+
+# Both branches are 1, the call in the condition still runs.
+print(1 if f() else 1)
@@ -0,0 +1,21 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+class A(object):
+    x:int = 1
+
+    def get(self: "A") -> int:
+        return self.x
+
+class B(A):
+    y:int = 2
+
+b:B = None
+a:A = None
+b = B()
+print(b.x)
+b.x = 5
+print(b.get())
+print(b.x + b.y)
+a = b
+a.x = 7
+print(b.x)
@@ -0,0 +1,47 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+# A ends in a bool, so the fields B adds after it start past some padding.
+class A(object):
+    i:int = 1
+    o:object = None
+    b:bool = True
+
+    def total(self: "A") -> int:
+        if self.b:
+            return self.i
+        return 0 - self.i
+
+class B(A):
+    c:bool = False
+    s:str = "b"
+    n:int = 2
+    p:object = None
+
+b:B = None
+a:A = None
+b = B()
+b.o = "o"
+b.p = 3
+print(b.i)
+print(b.b)
+print(b.o)
+print(b.c)
+print(b.s)
+print(b.n)
+print(b.p)
+
+b.i = 10
+b.b = False
+b.o = b.s
+b.c = True
+b.s = "t"
+b.n = 20
+print(b.total())
+print(b.o)
+a = b
+a.b = True
+a.i = a.i + b.n
+print(b.total())
+print(b.c)
+print(b.s)
+print(b.p)
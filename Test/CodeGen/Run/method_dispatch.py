@@ -0,0 +1,36 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+# RUN: %chocopy-llvm -emit-llvm %s | FileCheck %s.ll
+
+class Shape(object):
+    def sides(self: "Shape") -> int:
+        return 0
+
+class Triangle(Shape):
+    def sides(self: "Triangle") -> int:
+        return 3
+
+class Square(Shape):
+    def sides(self: "Square") -> int:
+        return 4
+
+class Polygon(object):
+    n:int = 5
+
+    def sides(self: "Polygon") -> int:
+        return self.n
+
+s:Shape = None
+p:Polygon = None
+
+# Subclasses override sides, so the calls on a Shape go through the dispatch
+# table.
+s = Triangle()
+print(s.sides())
+s = Square()
+print(s.sides())
+s = Shape()
+print(s.sides())
+
+# Nothing overrides Polygon.sides, so the call is direct.
+p = Polygon()
+print(p.sides())
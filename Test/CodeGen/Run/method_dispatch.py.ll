@@ -0,0 +1,7 @@
+CHECK-LABEL: define void @Main()
+CHECK-NOT: call fastcc i32 @"$Shape.sides"
+CHECK: call fastcc i32 %{{[^(]+}}(ptr
+CHECK: call fastcc i32 %{{[^(]+}}(ptr
+CHECK: call fastcc i32 %{{[^(]+}}(ptr
+CHECK-NOT: call fastcc i32 %{{[^(]+}}(ptr
+CHECK: call fastcc i32 @"$Polygon.sides"(ptr
@@ -0,0 +1,21 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+class Counter(object):
+    n:int = 5
+    name:str = "none"
+
+    def __init__(self: "Counter"):
+        self.n = 0
+        self.name = "counter"
+
+    def add(self: "Counter", k: int) -> int:
+        self.n = self.n + k
+        return self.n
+
+c:Counter = None
+c = Counter()
+print(c.n)
+print(c.name)
+c.add(3)
+print(c.add(4))
+print(Counter().add(1))
@@ -0,0 +1,23 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+def counter(start: int) -> int:
+    n:int = 0
+    def step(k: int) -> int:
+        nonlocal n
+        n = n + k
+        return n
+    n = start
+    step(1)
+    step(2)
+    return step(3)
+
+def outer(x: int) -> int:
+    y:int = 10
+    def inner() -> int:
+        return x + y
+    y = 20
+    return inner()
+
+print(counter(0))
+print(counter(100))
+print(outer(1))
@@ -0,0 +1,29 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+c:bool = True
+x:int = 5
+i:int = 0
+j:int = 0
+n:int = 0
+
+# x = 0 runs once, before the loop, not on every iteration.
+if c:
+    x = 0
+    while x < 3:
+        x = x + 1
+print(x)
+
+while i < 2:
+    j = 0
+    while j < 3:
+        j = j + 1
+        n = n + 1
+    i = i + 1
+print(n)
+
+# Control goes from the if to the loop after it, not to the exit.
+if c:
+    n = 0
+while n < 4:
+    n = n + 1
+print(n)
@@ -0,0 +1,25 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+class C(object):
+    a:object = 3
+    b:object = True
+    c:object = "s"
+
+x:object = 1
+y:object = False
+c:C = None
+
+def show() -> object:
+    print(x)
+    print(y)
+    return None
+
+show()
+c = C()
+print(c.a)
+print(c.b)
+print(c.c)
+c.a = x
+x = 4
+print(c.a)
+print(x)
@@ -0,0 +1,18 @@
+# RUN: %chocopy-llvm -fruntime=%chocopy-runtime -o %t %s
+# RUN: not %t > %t.out 2> %t.err
+# RUN: FileCheck %s.out --input-file=%t.out
+# RUN: FileCheck %s.err --input-file=%t.err
+
+class C(object):
+    n:int = 1
+
+c:C = None
+s:str = "ab"
+x:int = 0
+
+c = C()
+print(c.n + 41)
+print(c is None)
+print(s + "c")
+print(7 // x)
+print("not run")
@@ -0,0 +1,26 @@
+# RUN: %chocopy-llvm -run %s | FileCheck %s.out
+
+def greet(name: str) -> str:
+    return "Hello, " + name + "!"
+
+def same(a: str, b: str) -> bool:
+    return a == b
+
+def differ(a: str, b: str) -> bool:
+    return a != b
+
+s:str = ""
+i:int = 0
+
+# The result outlives the loop that builds it.
+while i < 3:
+    s = s + "ab"
+    i = i + 1
+print(greet("world"))
+print(s)
+print(same(s, "ababab"))
+print(same(s, "ababac"))
+print(same(s, "abab"))
+print(same("", ""))
+print(differ(s, "ababab"))
+print(differ("x", "y"))
@@ -0,0 +1,11 @@
+# RUN: %chocopy-llvm -run %s 2>&1 | FileCheck %s.err
+
+x:[int] = None
+y:[int] = None
+i:int = 0
+
+print("not run")
+x = [1, 2]
+for i in x:
+    pass
+y = x + x
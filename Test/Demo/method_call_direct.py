@@ -0,0 +1,27 @@
+# Method call microbenchmark, devirtualized: no subclass of Polygon
+# overrides sides, so a call on a Polygon is direct and can be inlined.
+# Same work as method_call_virtual.py.
+#   chocopy-llvm -run -ftime-report method_call_direct.py
+class Polygon(object):
+    n:int = 0
+
+    def sides(self: "Polygon") -> int:
+        return self.n
+
+s:Polygon = None
+t:Polygon = None
+q:Polygon = None
+i:int = 0
+total:int = 0
+
+t = Polygon()
+t.n = 3
+q = Polygon()
+q.n = 4
+while i < 10000000:
+    s = t
+    if i % 2 == 0:
+        s = q
+    total = total + s.sides()
+    i = i + 1
+print(total)
@@ -0,0 +1,30 @@
+# Method call microbenchmark, dispatched through the dispatch table: Shape
+# has a subclass overriding sides, so a call on a Shape is indirect.
+#   chocopy-llvm -run -ftime-report method_call_virtual.py
+class Shape(object):
+    def sides(self: "Shape") -> int:
+        return 0
+
+class Triangle(Shape):
+    def sides(self: "Triangle") -> int:
+        return 3
+
+class Square(Shape):
+    def sides(self: "Square") -> int:
+        return 4
+
+s:Shape = None
+t:Shape = None
+q:Shape = None
+i:int = 0
+total:int = 0
+
+t = Triangle()
+q = Square()
+while i < 10000000:
+    s = t
+    if i % 2 == 0:
+        s = q
+    total = total + s.sides()
+    i = i + 1
+print(total)
@@ -0,0 +1,17 @@
+# RUN: %chocopy-llvm --run-sema %s 2>&1 | FileCheck %s.err
+
+class A(object):
+    x:int = 1
+
+    def foo(self:"A") -> int:
+        return 0
+
+class B(A):
+    pass
+
+class C(B):
+    def x(self:"C") -> int:  # Bad
+        return 0
+    foo:str = ""  # Bad
+
+print(C().x + C().foo())
@@ -0,0 +1,8 @@
+# RUN: %chocopy-llvm --run-sema -fdiagnostics-format=json %s 2>&1 | FileCheck --check-prefix=JSON %s.err
+# RUN: %chocopy-llvm --run-sema -fdiagnostics-format=sarif %s 2>&1 | FileCheck --check-prefix=SARIF %s.err
+
+x:int = 1
+x:int = 2 # Duplicate declaration
+
+def f() -> int:
+    return True
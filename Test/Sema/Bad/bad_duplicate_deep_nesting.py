@@ -0,0 +1,81 @@
+# RUN: %chocopy-llvm --run-sema -print-stats %s 2>&1 | FileCheck %s.err
+
+def f1(a:int) -> object:
+    b:int = 1
+    def f2(a:int) -> object:
+        b:int = 2
+        def f3(a:int) -> object:
+            b:int = 3
+            def f4(a:int) -> object:
+                b:int = 4
+                def f5(a:int) -> object:
+                    b:int = 5
+                    def f6(a:int) -> object:
+                        b:int = 6
+                        def f7(a:int) -> object:
+                            b:int = 7
+                            def f8(a:int) -> object:
+                                b:int = 8
+                                b:int = 9 # Duplicate declaration
+                                pass
+                            pass
+                        pass
+                    pass
+                pass
+            pass
+        pass
+    pass
+
+def g1(a:int) -> object:
+    b:int = 1
+    def g2(a:int) -> object:
+        b:int = 2
+        def g3(a:int) -> object:
+            b:int = 3
+            def g4(a:int) -> object:
+                b:int = 4
+                def g5(a:int) -> object:
+                    b:int = 5
+                    def g6(a:int) -> object:
+                        b:int = 6
+                        def g7(a:int) -> object:
+                            b:int = 7
+                            def g8(a:int) -> object:
+                                b:int = 8
+                                pass
+                            pass
+                        pass
+                    pass
+                pass
+            pass
+        pass
+    pass
+
+def h1(a:int) -> object:
+    b:int = 1
+    def h2(a:int) -> object:
+        b:int = 2
+        def h3(a:int) -> object:
+            b:int = 3
+            def h4(a:int) -> object:
+                b:int = 4
+                def h5(a:int) -> object:
+                    b:int = 5
+                    def h6(a:int) -> object:
+                        b:int = 6
+                        def h7(a:int) -> object:
+                            b:int = 7
+                            def h8(a:int) -> object:
+                                b:int = 8
+                                pass
+                            pass
+                        pass
+                    pass
+                pass
+            pass
+        pass
+    pass
+
+f1(1)
+g1(1)
+h1(1)
@@ -0,0 +1,16 @@
+# RUN: %chocopy-llvm --run-sema -ferror-limit=2 %s 2>&1 | FileCheck %s.err
+# RUN: %chocopy-llvm --run-sema -fsyntax-only %s 2>&1 | FileCheck --check-prefix=SYNTAX --allow-empty %s.err
+
+x:int = 1
+x:int = 2 # Duplicate declaration
+y:int = 1
+y:int = 2 # Duplicate declaration
+z:int = 1
+z:int = 3 # Dropped
+
+def f() -> int:
+    return True # Dropped
+
+x = "x" # Dropped
+
+# RUN: %chocopy-llvm --run-sema -ferror-limit=2 -fsema-threads=4 %s 2>&1 | FileCheck %s.err
@@ -0,0 +1,11 @@
+# RUN: %chocopy-llvm --run-sema -ferror-limit=2 %s 2>&1 | FileCheck %s.err
+# RUN: %chocopy-llvm --run-sema -ferror-limit=2 -fsema-threads=4 %s 2>&1 | FileCheck %s.err
+
+def f() -> int:
+    return True # Second error
+
+def g() -> int:
+    return False # Dropped
+
+x:int = 1
+x:int = 2 # First error
@@ -0,0 +1,31 @@
+# RUN: %chocopy-llvm --run-sema -Wunused %s 2>&1 | FileCheck %s.err
+
+def f(a: int) -> int:
+    x: int = 0
+    y: int = 0
+    unused: bool = False
+    x = a + 1
+    y = x
+    y = 2
+    return x
+
+print(f(1))
+
+def g(n: int) -> int:
+    i: int = 0
+    x: int = 0
+    z: int = 0
+    if n > 0:
+        x = 0
+        while x < n:
+            x = x + 1
+    while i < n:
+        x = 0
+        while x < 3:
+            z = i
+            z = x
+            x = x + 1
+            i = i + z
+    return x + i
+
+print(g(2))
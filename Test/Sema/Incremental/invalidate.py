@@ -0,0 +1,12 @@
+# RUN: %chocopy-llvm --run-sema -print-stats -fincremental-edit=%s.edit %s 2>&1 | FileCheck %s.err
+
+def show(x:int) -> str:
+    return "shown"
+
+def caller() -> str:
+    return show(1)
+
+def unrelated() -> int:
+    return 1
+
+print(caller())
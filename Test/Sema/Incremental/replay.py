@@ -0,0 +1,9 @@
+# RUN: %chocopy-llvm --run-sema -print-stats -fincremental-edit=%s.edit %s 2>&1 | FileCheck %s.err
+
+def wrong() -> int:
+    return "not an int"
+
+def edited() -> int:
+    return 1
+
+print(wrong())
@@ -0,0 +1,16 @@
+# RUN: %chocopy-llvm --run-sema -print-stats -fincremental-edit=%s.edit %s 2>&1 | FileCheck %s.err
+# RUN: %chocopy-llvm -run -fincremental-edit=%s.edit %s | FileCheck --check-prefix=RUN %s.err
+
+def inc(x:int) -> int:
+    return x + 1
+
+def twice(x:int) -> int:
+    y:int = 0
+    y = inc(x)
+    return y * 2
+
+def answer() -> int:
+    return 3
+
+print(twice(1))
+print(answer())